@@ -29,6 +29,8 @@ import platform
 import json
 import shutil
 import re
+import glob
+import subprocess
 from utils.python.codal_utils import system, build, read_json, checkgit, read_config, update, revision, printstatus, status, get_next_version, lock, delete_build_folder, generate_docs
 
 parser = optparse.OptionParser(usage="usage: %prog target-name-or-url [options]", description="This script manages the build system for a codal device. Passing a target-name generates a codal.json for that devices, to list all devices available specify the target-name as 'ls'.")
@@ -46,10 +48,59 @@ parser.add_option('-r', '--revision', dest='revision', action="store", help='Che
 parser.add_option('-d', '--dev', dest='dev', action="store_true", help='enable developer mode (does not use target-locked.json)', default=False)
 parser.add_option('-g', '--generate-docs', dest='generate_docs', action="store_true", help='generate documentation for the current target', default=False)
 parser.add_option('-j', '--parallelism', dest='parallelism', action="store", help='Set the number of parallel threads to build with, if supported', default=10)
+parser.add_option('-p', '--profile', dest='profile', action="store", help='Game core build profile: size (-Os), speed (-O2) or fast (-O3)', default="")
+parser.add_option('--lto', dest='lto', action="store_true", help='Link-time optimize across the game sources', default=False)
+parser.add_option('--profile-report', dest='profile_report', action="store_true", help='Build every game core profile and compare flash size and host ns/step', default=False)
 parser.add_option('-n', '--lines', dest='detail_lines', action="store", help="Sets the number of detail lines to output (only relevant to --status)", default=3 )
 
 (options, args) = parser.parse_args()
 
+# Game core profiles compared by --profile-report, as (profile, lto)
+SNAKE_PROFILES = [("size", False), ("speed", False), ("fast", False), ("size", True), ("fast", True)]
+
+def profile_args(profile, lto):
+    return "-DSNAKE_PROFILE={} -DSNAKE_LTO={}".format(profile, "ON" if lto else "OFF")
+
+# Flash of the whole image and of the game core, from the map of the last device build
+def profile_flash():
+    maps = glob.glob("*.map")
+    if not maps:
+        return None
+    out = subprocess.run(["node", "../utils/debug/meminfo.js", maps[0], "--module", "Game.cpp,AutoPlayer.cpp,Replay.cpp", "--json"],
+                         stdout=subprocess.PIPE, universal_newlines=True).stdout
+    return json.loads(out.strip().splitlines()[-1]) if out.strip() else None
+
+# Best ns/step of the host benchmark built with the same profile; None without a host compiler
+def profile_ns_per_step(profile, lto, runs = 5):
+    host_dir = "host-" + profile + ("-lto" if lto else "")
+    if subprocess.call("cmake -S .. -B {} -DSNAKE_HOST_BUILD=ON {} > /dev/null".format(host_dir, profile_args(profile, lto)), shell=True) != 0:
+        return None
+    if subprocess.call("cmake --build {} --target snake_bench > /dev/null".format(host_dir), shell=True) != 0:
+        return None
+    best = None
+    for _ in range(runs):
+        out = subprocess.run([os.path.join(host_dir, "snake_bench")], stdout=subprocess.PIPE, universal_newlines=True).stdout
+        m = re.search(r"ns/step=([0-9.]+)", out)
+        if m and (best is None or float(m.group(1)) < best):
+            best = float(m.group(1))
+    return best
+
+# Build the device image in every profile, then print flash and host speed side by side
+# Flash is per file, so under LTO the core's own share can't be told apart from the image's.
+def profile_report(options):
+    rows = []
+    for profile, lto in SNAKE_PROFILES:
+        build(True, False, options.parallelism, profile_args(profile, lto))
+        rows.append((profile + (" +lto" if lto else ""), profile_flash(), profile_ns_per_step(profile, lto)))
+
+    print("%-12s %10s %10s %10s" % ("profile", "flash", "core", "ns/step"))
+    for name, flash, ns in rows:
+        image = str(flash["rom"]) if flash else "-"
+        core = str(flash.get("moduleRom", "-")) if flash else "-"
+        if flash and name.endswith("+lto"):
+            core = "-"
+        print("%-12s %10s %10s %10s" % (name, image, core, "%.2f" % ns if ns else "-"))
+
 if not os.path.exists("build"):
     os.mkdir("build")
 
@@ -141,7 +192,13 @@ if not options.test_platform:
         generate_docs()
         exit(0)
 
-    build(options.clean, verbose=options.verbose, parallelism=options.parallelism)
+    if options.profile_report:
+        profile_report(options)
+        exit(0)
+
+    # Always passed, so a build after --profile-report doesn't keep its last profile
+    build(options.clean, verbose=options.verbose, parallelism=options.parallelism,
+          cmake_args=profile_args(options.profile, options.lto))
     exit(0)
 
 for json_obj in test_json:
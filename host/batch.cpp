@@ -0,0 +1,371 @@
+/**
+ * Bit-parallel batch simulator for evaluating autoplay policies
+ *
+ * Advances LANES independent games in lockstep, kept as a structure of arrays
+ * with each game's occupancy in one 32-bit word. Turning, moving the head and
+ * the collision and food checks are done across all lanes at once with GCC
+ * vector extensions, which lower to SSE on x86 hosts and NEON on ARM ones.
+ * Only the body links and food placement are walked lane by lane.
+ *
+ * The batch plays by the same rules and PRNG as the scalar core, so with random
+ * turns every game is checked against stepGame() for the same seed.
+ */
+
+#include <chrono>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Game.h"
+#include "RandomTurns.h"
+
+// One native vector of 32-bit lanes: wider vectors only get split back into these
+#ifndef LANES
+#ifdef __AVX2__
+#define LANES 8
+#else
+#define LANES 4
+#endif
+#endif
+#define STEP_LIMIT 100000
+
+static_assert(GRID_CELLS <= 32, "Batch games keep their occupancy in one word");
+
+typedef uint32_t Lanes __attribute__((vector_size(LANES * sizeof(uint32_t))));
+
+// Directions in clockwise order, so a turn is a step around the compass
+#define LANE_UP 0
+#define LANE_RIGHT 1
+#define LANE_DOWN 2
+#define LANE_LEFT 3
+
+// Turns as the policies hand them back; the same values as Turn
+#define LANE_STRAIGHT 0
+#define LANE_TURN_LEFT 1
+#define LANE_TURN_RIGHT 2
+
+// LANES games, one per vector element
+// Each cell of a body links to the next cell towards the head, so moving the
+// tail end on is one lookup and the body needs no ring buffer.
+typedef struct {
+    Lanes occupancy;
+    Lanes head;
+    Lanes row;
+    Lanes col;
+    Lanes direction;
+    Lanes tailEnd;
+    Lanes food;
+    Lanes cells;
+    Lanes rng;
+    Lanes turnRng;
+    Lanes alive;
+    Lanes won;
+    Lanes score;
+    Lanes steps;
+    uint8_t towardHead[GRID_CELLS][LANES];
+} Batch;
+
+// How one game finished
+typedef struct {
+    uint32_t score;
+    uint32_t steps;
+    bool won;
+} GameResult;
+
+// Picks every lane's turn for the coming step
+typedef Lanes (*Policy)(Batch *batch);
+
+// Function declarations
+static Lanes broadcast(uint32_t value);
+static Lanes select(Lanes mask, Lanes a, Lanes b);
+static bool anyLane(Lanes mask);
+static Lanes turnDirection(Lanes direction, Lanes turn);
+static void advance(Lanes direction, Lanes *row, Lanes *col);
+static Lanes torusDistance(Lanes a, Lanes b, int size);
+static void placeLaneFood(Batch *batch, int lane);
+static void startLane(Batch *batch, int lane, uint64_t game);
+static void stepBatch(Batch *batch, Policy policy);
+static Lanes randomPolicy(Batch *batch);
+static Lanes greedyPolicy(Batch *batch);
+static uint32_t turnSeed(uint64_t game);
+
+// Every lane set to the same value
+static Lanes broadcast(uint32_t value) {
+    return Lanes() + value;
+}
+
+// Lane-wise mask ? a : b, where each mask lane is all ones or all zeros
+static Lanes select(Lanes mask, Lanes a, Lanes b) {
+    return (mask & a) | (~mask & b);
+}
+
+// Check if any lane of a mask is set
+static bool anyLane(Lanes mask) {
+    uint32_t any = 0;
+    for (int lane = 0; lane < LANES; lane++) {
+        any |= mask[lane];
+    }
+    return any != 0;
+}
+
+// Left is a quarter turn anticlockwise, right a quarter turn clockwise
+static Lanes turnDirection(Lanes direction, Lanes turn) {
+    Lanes left = (Lanes)(turn == LANE_TURN_LEFT);
+    Lanes right = (Lanes)(turn == LANE_TURN_RIGHT);
+    return (direction + (left & 3) + (right & 1)) & 3;
+}
+
+// Move a row and column one step, wrapping at the edges as the Board does
+static void advance(Lanes direction, Lanes *row, Lanes *col) {
+    // Comparison lanes are all ones when true, so adding one is a step back
+    *row = *row + (Lanes)(direction == LANE_UP) - (Lanes)(direction == LANE_DOWN);
+    *col = *col + (Lanes)(direction == LANE_LEFT) - (Lanes)(direction == LANE_RIGHT);
+    *row = select((Lanes)(*row == broadcast(UINT32_MAX)), broadcast(GameBoard::HEIGHT - 1), *row);
+    *row = select((Lanes)(*row == broadcast(GameBoard::HEIGHT)), broadcast(0), *row);
+    *col = select((Lanes)(*col == broadcast(UINT32_MAX)), broadcast(GameBoard::WIDTH - 1), *col);
+    *col = select((Lanes)(*col == broadcast(GameBoard::WIDTH)), broadcast(0), *col);
+}
+
+// Shortest distance between two rows or columns on a board that wraps
+static Lanes torusDistance(Lanes a, Lanes b, int size) {
+    Lanes distance = select((Lanes)(a > b), a - b, b - a);
+    Lanes around = broadcast(size) - distance;
+    return select((Lanes)(around < distance), around, distance);
+}
+
+// Put a lane's food on its n-th free cell, picked the same way as getRandomCoords()
+static void placeLaneFood(Batch *batch, int lane) {
+    uint32_t rng = batch->rng[lane];
+    uint32_t freeCells = GRID_CELLS - batch->cells[lane];
+    uint32_t n = (uint32_t)(((uint64_t)xorshift32(&rng) * freeCells) >> 32);
+    batch->rng[lane] = rng;
+
+    // Built in 64 bits, as shifting a 32-bit one by 32 for a full word is undefined
+    uint32_t freeBits = ~batch->occupancy[lane] & (uint32_t)((1ull << GRID_CELLS) - 1);
+    while (n--) {
+        freeBits &= freeBits - 1;
+    }
+    batch->food[lane] = __builtin_ctz(freeBits);
+}
+
+// Seed of a game's random turns, kept apart from the game's own PRNG
+static uint32_t turnSeed(uint64_t game) {
+    uint32_t seed = 0x9E3779B9u ^ ((uint32_t)(game + 1) * 0x85EBCA6Bu);
+    return seed ? seed : 1;
+}
+
+// Start a game in one lane, laid out as initGame() would for one player
+static void startLane(Batch *batch, int lane, uint64_t game) {
+    int row = GameBoard::HEIGHT / 2;
+    Coords head = {(int8_t)row, 2};
+    Coords tail = {(int8_t)row, 1};
+    uint32_t seed = (uint32_t)(game + 1);
+
+    batch->row[lane] = head.row;
+    batch->col[lane] = head.col;
+    batch->head[lane] = GameBoard::cellIndex(head);
+    batch->tailEnd[lane] = GameBoard::cellIndex(tail);
+    batch->occupancy[lane] = (1u << GameBoard::cellIndex(head)) | (1u << GameBoard::cellIndex(tail));
+    batch->direction[lane] = LANE_RIGHT;
+    batch->cells[lane] = 2;
+    batch->rng[lane] = seed ? seed : 0x2545F491;
+    batch->turnRng[lane] = turnSeed(game);
+    batch->alive[lane] = UINT32_MAX;
+    batch->won[lane] = 0;
+    batch->score[lane] = 0;
+    batch->steps[lane] = 0;
+    batch->towardHead[GameBoard::cellIndex(tail)][lane] = GameBoard::cellIndex(head);
+    placeLaneFood(batch, lane);
+}
+
+// Take one step in every lane still playing
+static void stepBatch(Batch *batch, Policy policy) {
+    Lanes alive = batch->alive;
+    Lanes one = broadcast(1);
+
+    batch->direction = select(alive, turnDirection(batch->direction, policy(batch)), batch->direction);
+    Lanes row = batch->row;
+    Lanes col = batch->col;
+    advance(batch->direction, &row, &col);
+    Lanes next = row * GameBoard::WIDTH + col;
+    Lanes nextBit = one << next;
+
+    // Moving into the end of the tail is safe, it leaves as the head arrives
+    Lanes hit = (Lanes)((batch->occupancy & nextBit) != 0) & (Lanes)(next != batch->tailEnd);
+    Lanes eat = alive & ~hit & (Lanes)(next == batch->food);
+    Lanes full = eat & (Lanes)(batch->cells + 1 >= GRID_CELLS);
+    Lanes move = alive & ~hit & ~eat;
+    Lanes moved = alive & ~hit;
+
+    batch->occupancy = (batch->occupancy & ~(move & (one << batch->tailEnd))) | (moved & nextBit);
+    for (int lane = 0; lane < LANES; lane++) {
+        if (moved[lane]) {
+            batch->towardHead[batch->head[lane]][lane] = next[lane];
+        }
+        if (move[lane]) {
+            batch->tailEnd[lane] = batch->towardHead[batch->tailEnd[lane]][lane];
+        }
+    }
+    batch->head = select(moved, next, batch->head);
+    batch->row = select(moved, row, batch->row);
+    batch->col = select(moved, col, batch->col);
+    batch->cells += eat & one;
+    batch->score += eat & ~full & one;
+    batch->won |= full;
+    batch->steps += alive & one;
+
+    // Food only needs placing in the few lanes that just ate
+    Lanes ate = eat & ~full;
+    for (int lane = 0; lane < LANES; lane++) {
+        if (ate[lane]) {
+            placeLaneFood(batch, lane);
+        }
+    }
+
+    batch->alive = alive & ~hit & ~full & (Lanes)(batch->steps < STEP_LIMIT);
+}
+
+// randomTurnFrom() in every lane at once, checked against it through referenceTurn()
+static Lanes randomPolicy(Batch *batch) {
+    Lanes x = batch->turnRng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    batch->turnRng = select(batch->alive, x, batch->turnRng);
+
+    Lanes pick = x & 7;
+    return select((Lanes)(pick == 0), broadcast(LANE_TURN_LEFT),
+                  select((Lanes)(pick == 1), broadcast(LANE_TURN_RIGHT), broadcast(LANE_STRAIGHT)));
+}
+
+// Head for the food by the shortest way round, never into a body if it can be helped
+static Lanes greedyPolicy(Batch *batch) {
+    Lanes foodRow = batch->food / GameBoard::WIDTH;
+    Lanes foodCol = batch->food % GameBoard::WIDTH;
+    Lanes bestTurn = broadcast(LANE_STRAIGHT);
+    Lanes bestCost = broadcast(UINT32_MAX);
+
+    for (uint32_t turn = LANE_STRAIGHT; turn <= LANE_TURN_RIGHT; turn++) {
+        Lanes row = batch->row;
+        Lanes col = batch->col;
+        advance(turnDirection(batch->direction, broadcast(turn)), &row, &col);
+        Lanes cell = row * GameBoard::WIDTH + col;
+        Lanes blocked = (Lanes)((batch->occupancy & (broadcast(1) << cell)) != 0) &
+                        (Lanes)(cell != batch->tailEnd);
+
+        Lanes cost = torusDistance(row, foodRow, GameBoard::HEIGHT) +
+                     torusDistance(col, foodCol, GameBoard::WIDTH) + (blocked & GRID_CELLS);
+        Lanes better = (Lanes)(cost < bestCost);
+        bestTurn = select(better, broadcast(turn), bestTurn);
+        bestCost = select(better, cost, bestCost);
+    }
+    return bestTurn;
+}
+
+// Random turns for the scalar reference, from the same per-game seed as the batch
+static uint32_t referenceTurnState;
+
+static Turn referenceTurn(int player) {
+    return randomTurnFrom(&referenceTurnState);
+}
+
+static const Platform referencePlatform = {referenceTurn, ignoreCell, ignoreStep};
+
+int main(int argc, char **argv) {
+    uint64_t games = 1000000;
+    bool greedy = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--greedy") == 0) {
+            greedy = true;
+        } else {
+            games = strtoull(argv[i], NULL, 10);
+        }
+    }
+    if (games < LANES) {
+        games = LANES;
+    }
+
+    std::vector<GameResult> results(games);
+    uint64_t steps = 0;
+    uint64_t wins = 0;
+    uint64_t points = 0;
+    Policy policy = greedy ? greedyPolicy : randomPolicy;
+
+    // Games run to very different lengths, so a lane takes the next game as soon as its
+    // last one ends rather than idling until the whole batch is done
+    Batch batch;
+    memset(&batch, 0, sizeof(batch));
+    uint64_t laneGame[LANES];
+    uint64_t nextGame = 0;
+    Lanes active = broadcast(UINT32_MAX);
+    for (int lane = 0; lane < LANES; lane++) {
+        laneGame[lane] = nextGame;
+        startLane(&batch, lane, nextGame++);
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (anyLane(active)) {
+        stepBatch(&batch, policy);
+        if (!anyLane(active & ~batch.alive)) {
+            continue;
+        }
+
+        for (int lane = 0; lane < LANES; lane++) {
+            if (!active[lane] || batch.alive[lane]) {
+                continue;
+            }
+            GameResult *result = &results[laneGame[lane]];
+            result->score = batch.score[lane];
+            result->steps = batch.steps[lane];
+            result->won = batch.won[lane] != 0;
+            steps += result->steps;
+            wins += result->won;
+            points += result->score;
+
+            if (nextGame < games) {
+                laneGame[lane] = nextGame;
+                startLane(&batch, lane, nextGame++);
+            } else {
+                active[lane] = 0;
+            }
+        }
+    }
+    double batchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("board=%dx%d policy=%s lanes=%d games=%llu steps=%llu wins=%llu avg_score=%.2f\n",
+           GameBoard::WIDTH, GameBoard::HEIGHT, greedy ? "greedy" : "random", LANES,
+           (unsigned long long)games, (unsigned long long)steps, (unsigned long long)wins,
+           (double)points / games);
+    printf("batch games/sec=%.0f steps/sec=%.0f\n", games / batchSeconds, steps / batchSeconds);
+    if (greedy) {
+        return 0;
+    }
+
+    // Play the same games through the scalar core, for the speedup and to check every result
+    setPlatform(&referencePlatform);
+    uint64_t mismatches = 0;
+    start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < games; i++) {
+        referenceTurnState = turnSeed(i);
+        initGame((uint32_t)(i + 1));
+        uint32_t gameSteps = 0;
+        while (game.status == ONGOING && gameSteps < STEP_LIMIT) {
+            stepGame();
+            gameSteps++;
+        }
+
+        const GameResult *result = &results[i];
+        if (result->score != game.score || result->steps != gameSteps || result->won != (game.status == WON)) {
+            if (mismatches++ == 0) {
+                printf("MISMATCH seed=%u batch score=%u steps=%u core score=%u steps=%u\n", (uint32_t)(i + 1),
+                       result->score, result->steps, game.score, gameSteps);
+            }
+        }
+    }
+    double scalarSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("scalar games/sec=%.0f speedup=%.1fx mismatches=%llu\n", games / scalarSeconds,
+           scalarSeconds / batchSeconds, (unsigned long long)mismatches);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,169 @@
+/**
+ * Headless benchmark for the snake game core
+ *
+ * Plays random games through stepGame() on the host as fast as possible and
+ * reports how long a step takes, so changes to the core can be measured
+ * without flashing a board.
+ */
+
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Game.h"
+#include "AutoPlayer.h"
+#include "RandomTurns.h"
+
+// State of the turn generator, separate from the game's own PRNG
+static uint32_t turnState = RANDOM_TURN_SEED;
+
+// Steer every player from the one turn stream
+static Turn randomTurn(int player) {
+    return randomTurnFrom(&turnState);
+}
+
+// The nested switch applyTurn() used before the turn table, kept to benchmark against
+// Not inlined, as the table version is only reachable through a call into Game.cpp.
+__attribute__((noinline)) static Direction applyTurnSwitch(Direction direction, Turn turn) {
+    switch (turn) {
+        case TURN_LEFT:
+            switch (direction) {
+                case UP:
+                    return LEFT;
+                case DOWN:
+                    return RIGHT;
+                case LEFT:
+                    return DOWN;
+                case RIGHT:
+                    return UP;
+            }
+            break;
+
+        case TURN_RIGHT:
+            switch (direction) {
+                case UP:
+                    return RIGHT;
+                case DOWN:
+                    return LEFT;
+                case LEFT:
+                    return UP;
+                case RIGHT:
+                    return DOWN;
+            }
+            break;
+
+        case TURN_NONE:
+            break;
+    }
+
+    return direction;
+}
+
+// Time a chain of turns through one applyTurn() implementation, in ns per turn
+// Each turn depends on the last direction, so the cost is latency, mispredicts included.
+static double timeTurns(Direction (*apply)(Direction, Turn), const Turn *turns, int count, int rounds,
+                        Direction *result) {
+    Direction direction = UP;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (int i = 0; i < count; i++) {
+            direction = apply(direction, turns[i]);
+        }
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    *result = direction;
+    return std::chrono::duration<double>(end - start).count() * 1e9 / ((double)count * rounds);
+}
+
+// Check the turn table against the switch, then race the two on a random turn stream
+static bool benchTurns(void) {
+    for (int direction = 0; direction < DIRECTION_COUNT; direction++) {
+        for (int turn = 0; turn < TURN_COUNT; turn++) {
+            if (applyTurn((Direction)direction, (Turn)turn) != applyTurnSwitch((Direction)direction, (Turn)turn)) {
+                printf("turn table disagrees with the switch at direction=%d turn=%d\n", direction, turn);
+                return false;
+            }
+        }
+    }
+
+    // Uniform turns, so the switch's branches can't be learnt
+    static Turn turns[1 << 16];
+    for (int i = 0; i < (1 << 16); i++) {
+        randomTurn(0);
+        turns[i] = (Turn)(turnState % TURN_COUNT);
+    }
+
+    Direction tableEnd;
+    Direction switchEnd;
+    double switchNs = timeTurns(applyTurnSwitch, turns, 1 << 16, 200, &switchEnd);
+    double tableNs = timeTurns(applyTurn, turns, 1 << 16, 200, &tableEnd);
+    printf("turn_switch_ns=%.2f turn_table_ns=%.2f\n", switchNs, tableNs);
+    return tableEnd == switchEnd;
+}
+
+// Read a whole decimal number, returning false if there's anything else in the argument
+static bool parseCount(const char *text, uint64_t *value) {
+    char *end;
+    if (text[0] < '0' || text[0] > '9') {
+        return false;
+    }
+    *value = strtoull(text, &end, 10);
+    return *end == 0;
+}
+
+// Explain the arguments and ask for them again
+static int usage(const char *program) {
+    fprintf(stderr, "usage: %s [steps] [--auto]\n", program);
+    return 2;
+}
+
+static const Platform randomPlatform = {randomTurn, ignoreCell, ignoreStep};
+static const Platform autoPlatform = {autoPlayerTurn, ignoreCell, ignoreStep};
+
+int main(int argc, char **argv) {
+    uint64_t steps = 10000000;
+    uint64_t games = 1;
+    uint64_t wins = 0;
+    bool autoplay = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--auto") == 0) {
+            autoplay = true;
+        } else if (!parseCount(argv[i], &steps)) {
+            return usage(argv[0]);
+        }
+    }
+    if (steps == 0) {
+        // The rates below are per step
+        return usage(argv[0]);
+    }
+
+    autoPlayerInit();
+    setPlatform(autoplay ? &autoPlatform : &randomPlatform);
+    initGame(1);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < steps; i++) {
+        if (game.status != ONGOING) {
+            wins += game.status == WON;
+            initGame((uint32_t)++games);
+        }
+        stepGame();
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    printf("board=%dx%d player=%s steps=%llu games=%llu wins=%llu\n", GameBoard::WIDTH,
+           GameBoard::HEIGHT, autoplay ? "auto" : "random", (unsigned long long)steps,
+           (unsigned long long)games, (unsigned long long)wins);
+    printf("steps/sec=%.0f ns/step=%.2f\n", steps / seconds, seconds * 1e9 / steps);
+
+    // How much of the shortest step on the speed curve one step of the core uses
+    uint32_t floorUs = SpeedCurve::lengthUs[SPEED_LEVELS - 1];
+    printf("speed_curve_ms=");
+    for (int level = 0; level < SPEED_LEVELS; level++) {
+        printf("%s%.1f", level ? "," : "", SpeedCurve::lengthUs[level] / 1000.0);
+    }
+    printf("\nfloor_us=%u step_share=%.5f%%\n", floorUs, seconds * 1e9 / steps / (floorUs * 1000.0) * 100);
+    return benchTurns() ? 0 : 1;
+}
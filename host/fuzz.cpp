@@ -0,0 +1,452 @@
+/**
+ * Property tests for the snake game core
+ *
+ * Every host thread plays its own games through stepGame() and checks the
+ * core's invariants after each step against a model built from the snakes'
+ * bodies alone, plus the obstacles laid out at the start in that mode. A
+ * broken invariant is reported with the seed that breaks it, and the
+ * games/sec figure catches per-step slowdowns before flashing a board.
+ */
+
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Game.h"
+#include "AutoPlayer.h"
+#include "RandomTurns.h"
+
+// The first invariant a thread saw broken, and where
+typedef struct {
+    bool failed;
+    uint32_t seed;
+    uint64_t step;
+    int player;
+    const char *what;
+} Failure;
+
+// What one thread played
+typedef struct {
+    uint64_t games;
+    uint64_t steps;
+    uint64_t wins;
+    uint64_t fulls;
+    Failure failure;
+} FuzzResult;
+
+// Per-thread fuzzer state, next to the per-thread game in the core
+static thread_local uint32_t turnState;
+static thread_local FuzzResult *result;
+static thread_local uint32_t gameSeed;
+static thread_local uint64_t gameStep;
+
+// Obstacles as the game started, which nothing may move, eat or add to
+static thread_local uint32_t startObstacles[OCCUPANCY_WORDS];
+static thread_local int obstacleCells;
+
+// Note a broken invariant, keeping only the first one
+static void fail(int player, const char *what) {
+    if (result->failure.failed) {
+        return;
+    }
+    result->failure.failed = true;
+    result->failure.seed = gameSeed;
+    result->failure.step = gameStep;
+    result->failure.player = player;
+    result->failure.what = what;
+}
+
+// Steer every player from this thread's turn stream
+static Turn randomTurn(int player) {
+    return randomTurnFrom(&turnState);
+}
+
+// Check if a snake's body covers a cell, optionally leaving out the end of its tail
+static bool bodyCovers(const Snake *snake, Coords coords, bool skipTailEnd) {
+    if (coordsEqual(snake->head, coords)) {
+        return true;
+    }
+    for (int segment = skipTailEnd ? 1 : 0; segment < snake->tailLength; segment++) {
+        if (coordsEqual(snake->tail[tailIndex(snake, segment)], coords)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Check if a cell is one of the obstacles the game started with
+static bool startObstacle(Coords coords) {
+    int cell = GameBoard::cellIndex(coords);
+    return (startObstacles[cell >> 5] >> (cell & 31)) & 1u;
+}
+
+// Check if any of the foods out is on a cell
+static bool foodAt(Coords coords) {
+    bool found = coordsEqual(coords, game.foodCoords);
+    for (int i = 0; i < FOOD_COUNT - 1; i++) {
+        found = found || coordsEqual(coords, game.extraFood[i]);
+    }
+    return found;
+}
+
+// Check the step the core planned against one worked out from the bodies
+// Runs before the step is applied, so the snake is still in its old place.
+static void checkStep(int player, const StepResult *step) {
+    const Snake *snake = &game.snakes[player];
+    StepOutcome outcome = step->outcome;
+    Coords target = getNextMove(player);
+    if (!coordsEqual(step->target, target) || !coordsEqual(step->vacated, snake->tail[snake->tailStart])) {
+        fail(player, "step target or vacated cell differs from the snake");
+    }
+
+    // Without wraparound, stepping off an edge ends the game like hitting a body
+    Coords ahead;
+    ahead.row = snake->head.row + GameBoard::rowDelta(snake->direction);
+    ahead.col = snake->head.col + GameBoard::colDelta(snake->direction);
+
+    // A snake may move into the end of its own tail, which leaves as the head arrives
+    bool blocked = (game.mode == MODE_WALLS && GameBoard::isOutOfBounds(ahead)) || startObstacle(target);
+    int cells = obstacleCells;
+    for (int other = 0; other < game.playerCount; other++) {
+        blocked = blocked || bodyCovers(&game.snakes[other], target, other == player);
+        cells += 1 + game.snakes[other].tailLength;
+    }
+
+    StepOutcome expected = MOVE;
+    if (blocked) {
+        expected = COLLISION;
+    } else if (foodAt(target)) {
+        expected = cells + 1 >= GRID_CELLS ? FULL : EAT;
+    }
+    if (outcome != expected) {
+        fail(player, "step outcome differs from the model");
+    }
+
+    // Alone on the board, the last food is eaten with the tail one short of the maximum,
+    // less whatever the obstacles take up
+    if (game.playerCount == 1 && (outcome == EAT || outcome == FULL) &&
+        (outcome == FULL) != (snake->tailLength == MAX_SNAKE_LENGTH - 1 - obstacleCells)) {
+        fail(player, "FULL did not fire exactly at MAX_SNAKE_LENGTH - 1");
+    }
+    if (outcome == FULL) {
+        result->fulls++;
+    }
+}
+
+// Check if two cells are one step apart, wrapping at the edges
+static bool adjacent(Coords a, Coords b) {
+    for (int direction = 0; direction < DIRECTION_COUNT; direction++) {
+        if (coordsEqual(GameBoard::next(a, (Direction)direction), b)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Check the whole game state between steps
+static void checkState(void) {
+    uint32_t occupancy[OCCUPANCY_WORDS];
+    memcpy(occupancy, startObstacles, sizeof(occupancy));
+    int cells = obstacleCells;
+
+    for (int player = 0; player < game.playerCount; player++) {
+        const Snake *snake = &game.snakes[player];
+        if (snake->tailLength < 1 || snake->tailLength > MAX_SNAKE_LENGTH) {
+            fail(player, "tail length out of range");
+            return;
+        }
+
+        // Walk from the head to the end of the tail, marking each cell once
+        Coords previous = snake->head;
+        for (int segment = snake->tailLength; segment >= 0; segment--) {
+            Coords coords = segment == snake->tailLength ? snake->head : snake->tail[tailIndex(snake, segment)];
+            if (GameBoard::isOutOfBounds(coords)) {
+                fail(player, "body left the board");
+                return;
+            }
+            if (segment != snake->tailLength && !adjacent(previous, coords)) {
+                fail(player, "body is not contiguous");
+            }
+
+            int cell = GameBoard::cellIndex(coords);
+            uint32_t mask = 1u << (cell & 31);
+            if (occupancy[cell >> 5] & mask) {
+                fail(player, "body overlaps itself, another snake or an obstacle");
+            }
+            occupancy[cell >> 5] |= mask;
+            cells++;
+            previous = coords;
+        }
+    }
+
+    if (memcmp(occupancy, game.occupancy, sizeof(occupancy)) != 0) {
+        fail(-1, "occupancy bitboard out of sync with the bodies");
+    }
+    if (memcmp(startObstacles, game.obstacles, sizeof(startObstacles)) != 0) {
+        fail(-1, "obstacles changed during the game");
+    }
+    if (cells != game.occupiedCells) {
+        fail(-1, "occupied cell count out of sync with the bodies");
+    }
+
+    // Once won, the last food sits under the head
+    if (game.status != ONGOING) {
+        return;
+    }
+    if (GameBoard::isOutOfBounds(game.foodCoords)) {
+        fail(-1, "no food out with the game still going");
+        return;
+    }
+    for (int i = 0; i < FOOD_COUNT; i++) {
+        Coords coords = i == 0 ? game.foodCoords : game.extraFood[i - 1];
+        if (GameBoard::isOutOfBounds(coords)) {
+            continue;
+        }
+        if (game.mode != MODE_MULTI_FOOD && i != 0) {
+            fail(-1, "extra food out outside the multi-food mode");
+        }
+        int food = GameBoard::cellIndex(coords);
+        if ((occupancy[food >> 5] >> (food & 31)) & 1u) {
+            fail(-1, "food placed on a snake or an obstacle");
+        }
+        for (int j = 0; j < i; j++) {
+            Coords other = j == 0 ? game.foodCoords : game.extraFood[j - 1];
+            if (coordsEqual(coords, other)) {
+                fail(-1, "two foods on one cell");
+            }
+        }
+    }
+}
+
+// Snapshot the obstacles a new game laid out, checking there are as many as the mode asks for
+static void recordObstacles(void) {
+    memcpy(startObstacles, game.obstacles, sizeof(startObstacles));
+    obstacleCells = 0;
+    for (int w = 0; w < OCCUPANCY_WORDS; w++) {
+        obstacleCells += __builtin_popcount(startObstacles[w]);
+    }
+    if (obstacleCells != (game.mode == MODE_OBSTACLES ? OBSTACLE_COUNT : 0)) {
+        fail(-1, "wrong number of obstacles for the mode");
+    }
+}
+
+static const Platform randomPlatform = {randomTurn, ignoreCell, checkStep};
+static const Platform autoPlatform = {autoPlayerTurn, ignoreCell, checkStep};
+
+// Play one game through to the end, checking every step, and add it to the thread's totals
+static void playGame(uint32_t seed, int players, GameMode mode) {
+    gameSeed = seed;
+    gameStep = 0;
+    initGame(gameSeed, players, mode);
+    recordObstacles();
+    checkState();
+    while (game.status == ONGOING && !result->failure.failed) {
+        stepGame();
+        gameStep++;
+        checkState();
+    }
+    result->games++;
+    result->steps += gameStep;
+    result->wins += game.status == WON;
+}
+
+// Play every threads-th game from first, stopping at the first broken invariant
+static void fuzzThread(int first, int threads, uint64_t games, int players, GameMode mode, bool autoplay,
+                       FuzzResult *out) {
+    memset(out, 0, sizeof(*out));
+    result = out;
+    turnState = 0x9E3779B9u ^ ((uint32_t)(first + 1) * 0x85EBCA6Bu);
+    if (turnState == 0) {
+        turnState = 1;
+    }
+    setPlatform(autoplay ? &autoPlatform : &randomPlatform);
+
+    for (uint64_t i = first; i < games && !out->failure.failed; i += threads) {
+        playGame((uint32_t)(i + 1), players, mode);
+    }
+}
+
+// Cell of a serpentine walk over the board, which visits every cell without wrapping
+static Coords serpentineCell(int index) {
+    Coords coords;
+    coords.row = index / GameBoard::WIDTH;
+    coords.col = index % GameBoard::WIDTH;
+    if (coords.row % 2 != 0) {
+        coords.col = GameBoard::WIDTH - 1 - coords.col;
+    }
+    return coords;
+}
+
+// Grow one snake along the serpentine walk until it fills the board, checking every step
+// Random turns die long before the board fills, so FULL is reached by laying the board
+// out to suit: the mode's obstacles move to the end of the walk, and each food is put
+// straight ahead of the head. The steps themselves go through planStep and applyStep.
+static void fillBoard(GameMode mode, FuzzResult *out) {
+    memset(out, 0, sizeof(*out));
+    result = out;
+    setPlatform(&randomPlatform);
+    gameSeed = 1;
+    gameStep = 0;
+    initGame(gameSeed, 1, mode);
+
+    int obstacles = 0;
+    for (int w = 0; w < OCCUPANCY_WORDS; w++) {
+        obstacles += __builtin_popcount(game.obstacles[w]);
+    }
+    int freeCells = GRID_CELLS - obstacles;
+    if (freeCells < 3) {
+        return;
+    }
+
+    memset(game.occupancy, 0, sizeof(game.occupancy));
+    memset(game.obstacles, 0, sizeof(game.obstacles));
+    for (int i = freeCells; i < GRID_CELLS; i++) {
+        int cell = GameBoard::cellIndex(serpentineCell(i));
+        game.obstacles[cell >> 5] |= 1u << (cell & 31);
+        setOccupied(serpentineCell(i), true);
+    }
+
+    Snake *snake = &game.snakes[0];
+    snake->tail[0] = serpentineCell(0);
+    snake->head = serpentineCell(1);
+    snake->tailStart = 0;
+    snake->tailLength = 1;
+    snake->direction = serpentineCell(1).row == serpentineCell(0).row ? RIGHT : DOWN;
+    setOccupied(snake->tail[0], true);
+    setOccupied(snake->head, true);
+    game.occupiedCells = obstacles + 2;
+    game.foodCoords = serpentineCell(2);
+    Coords noFood = {-1, -1};
+    for (int i = 0; i < FOOD_COUNT - 1; i++) {
+        game.extraFood[i] = noFood;
+    }
+    recordObstacles();
+    checkState();
+
+    for (int i = 2; i < freeCells && game.status == ONGOING && !out->failure.failed; i++) {
+        Coords target = serpentineCell(i);
+        for (int direction = 0; direction < DIRECTION_COUNT; direction++) {
+            if (coordsEqual(GameBoard::next(snake->head, (Direction)direction), target)) {
+                turnSnake(0, turnToward(snake->direction, (Direction)direction));
+            }
+        }
+        game.foodCoords = target;
+
+        StepResult step;
+        planStep(0, &step);
+        applyStep(0, &step);
+        gameStep++;
+        checkState();
+    }
+
+    out->games = 1;
+    out->steps = gameStep;
+    if (!out->failure.failed && (game.status != WON || out->fulls != 1)) {
+        fail(0, "filling the board did not end the game with FULL");
+    }
+}
+
+// Read a whole decimal number, returning false if there's anything else in the argument
+static bool parseCount(const char *text, uint64_t *value) {
+    char *end;
+    if (text[0] < '0' || text[0] > '9') {
+        return false;
+    }
+    *value = strtoull(text, &end, 10);
+    return *end == 0;
+}
+
+// Explain the arguments and ask for them again
+static int usage(const char *program) {
+    fprintf(stderr, "usage: %s [games] [--threads N] [--players N] [--mode N] [--auto]\n", program);
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    uint64_t games = 1000000;
+    int threads = (int)std::thread::hardware_concurrency();
+    int players = 1;
+    int mode = MODE_WRAP;
+    bool autoplay = false;
+
+    for (int i = 1; i < argc; i++) {
+        uint64_t value = 0;
+        bool hasValue = i + 1 < argc && parseCount(argv[i + 1], &value);
+        if (strcmp(argv[i], "--auto") == 0) {
+            autoplay = true;
+        } else if (strcmp(argv[i], "--threads") == 0 && hasValue) {
+            threads = (int)value;
+            i++;
+        } else if (strcmp(argv[i], "--players") == 0 && hasValue) {
+            players = (int)value;
+            i++;
+        } else if (strcmp(argv[i], "--mode") == 0 && hasValue) {
+            mode = (int)value;
+            i++;
+        } else if (!parseCount(argv[i], &games)) {
+            return usage(argv[0]);
+        }
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+    if (players < 1 || players > MAX_PLAYERS) {
+        fprintf(stderr, "players must be 1 to %d\n", MAX_PLAYERS);
+        return 2;
+    }
+    if (mode < 0 || mode >= MODE_COUNT) {
+        fprintf(stderr, "mode must be 0 to %d\n", MODE_COUNT - 1);
+        return 2;
+    }
+
+    // The cycle is built once and shared; each thread plans in its own arena
+    autoPlayerInit();
+
+    std::vector<FuzzResult> results(threads);
+    std::vector<std::thread> workers;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int t = 0; t < threads; t++) {
+        workers.push_back(std::thread(fuzzThread, t, threads, games, players, (GameMode)mode, autoplay, &results[t]));
+    }
+    for (int t = 0; t < threads; t++) {
+        workers[t].join();
+    }
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+    // Outside the timing, so games/sec still measures the run asked for
+    FuzzResult fill;
+    fillBoard((GameMode)mode, &fill);
+
+    FuzzResult total;
+    memset(&total, 0, sizeof(total));
+    int failures = 0;
+    for (int t = 0; t < threads; t++) {
+        const FuzzResult *r = &results[t];
+        total.games += r->games;
+        total.steps += r->steps;
+        total.wins += r->wins;
+        total.fulls += r->fulls;
+        if (r->failure.failed) {
+            printf("FAIL thread=%d seed=%u step=%llu player=%d: %s\n", t, r->failure.seed,
+                   (unsigned long long)r->failure.step, r->failure.player, r->failure.what);
+            failures++;
+        }
+    }
+
+    if (fill.failure.failed) {
+        printf("FAIL fill step=%llu: %s\n", (unsigned long long)fill.failure.step, fill.failure.what);
+        failures++;
+    }
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    printf("board=%dx%d mode=%d players=%d player=%s threads=%d games=%llu steps=%llu wins=%llu fulls=%llu\n",
+           GameBoard::WIDTH, GameBoard::HEIGHT, mode, players, autoplay ? "auto" : "random", threads,
+           (unsigned long long)total.games, (unsigned long long)total.steps,
+           (unsigned long long)total.wins, (unsigned long long)total.fulls);
+    printf("fill steps=%llu fulls=%llu\n", (unsigned long long)fill.steps, (unsigned long long)fill.fulls);
+    printf("games/sec=%.0f steps/sec=%.0f\n", total.games / seconds, total.steps / seconds);
+    printf("%s\n", failures ? "invariants broken" : "invariants held");
+    return failures ? 1 : 0;
+}
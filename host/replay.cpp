@@ -0,0 +1,134 @@
+/**
+ * Record-and-replay round trip for the snake game core
+ *
+ * Records games through the same Replay calls the device uses, round-trips
+ * the replay through a raw byte copy as the flash log stores it, then plays
+ * it back from the seed and checks that playback ends on exactly the state
+ * the recording did. Games longer than a replay holds are checked up to the
+ * last recorded tick, and must come back marked truncated.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "Game.h"
+#include "AutoPlayer.h"
+#include "Replay.h"
+#include "RandomTurns.h"
+
+// Turn stream of the game being recorded
+static uint32_t turnState;
+
+// Whether the recording is steered by the autoplay planner, which plays long games
+static bool autoplay = false;
+
+// Steer the recording and note every turn taken, as the device does
+static Turn recordTurn(int player) {
+    Turn turn = autoplay ? autoPlayerTurn(player) : randomTurnFrom(&turnState);
+    replayRecord(turn);
+    return turn;
+}
+
+// Steer playback from the replay alone
+static Turn playbackTurn(int player) {
+    return replayNextTurn(player);
+}
+
+static const Platform recordPlatform = {recordTurn, ignoreCell, ignoreStep};
+static const Platform playbackPlatform = {playbackTurn, ignoreCell, ignoreStep};
+
+// Record one game and play it back, returning what broke or NULL if the round trip held
+static const char *roundTrip(uint32_t seed, GameMode mode, bool *truncated) {
+    turnState = RANDOM_TURN_SEED ^ (seed * 0x85EBCA6Bu);
+    if (turnState == 0) {
+        turnState = 1;
+    }
+
+    setPlatform(&recordPlatform);
+    replayBegin(seed, mode);
+    initGame(seed, 1, mode);
+    uint32_t steps = 0;
+    while (game.status == ONGOING && replay.ticks < REPLAY_MAX_TURNS) {
+        stepGame();
+        steps++;
+    }
+    Game recorded = game;
+
+    // A game still going once the replay is full loses the rest of its turns
+    *truncated = false;
+    if (game.status == ONGOING) {
+        stepGame();
+        *truncated = true;
+        if (!replay.truncated) {
+            return "replay full but not marked truncated";
+        }
+    }
+    if (replay.ticks != steps) {
+        return "recorded tick count differs from the steps played";
+    }
+
+    // Round-trip the replay through raw bytes, as the flash log stores it
+    static uint8_t stored[sizeof(Replay)];
+    memcpy(stored, &replay, sizeof(replay));
+    memset(&replay, 0xA5, sizeof(replay));
+    memcpy(&replay, stored, sizeof(replay));
+
+    setPlatform(&playbackPlatform);
+    replayRewind();
+    initGame(replay.seed, 1, replay.mode);
+    for (uint32_t step = 0; step < steps; step++) {
+        if (game.status != ONGOING) {
+            return "playback ended before the recording did";
+        }
+        stepGame();
+    }
+
+    if (!replayFinished()) {
+        return "playback left recorded turns unused";
+    }
+    if (memcmp(&game, &recorded, sizeof(game)) != 0) {
+        return "playback finished on a different state";
+    }
+    if (replay.truncated != *truncated || replay.mode != mode) {
+        return "replay header changed in the round trip";
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    uint64_t games = 20000;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--auto") == 0) {
+            autoplay = true;
+        } else if (argv[i][0] >= '0' && argv[i][0] <= '9') {
+            games = strtoull(argv[i], NULL, 10);
+        } else {
+            fprintf(stderr, "usage: %s [games] [--auto]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    autoPlayerInit();
+
+    uint64_t truncatedGames = 0;
+    int failures = 0;
+    for (uint64_t i = 0; i < games; i++) {
+        uint32_t seed = (uint32_t)(i + 1);
+        GameMode mode = (GameMode)(i % MODE_COUNT);
+        bool truncated;
+        const char *what = roundTrip(seed, mode, &truncated);
+        if (what) {
+            printf("FAIL seed=%u mode=%d: %s\n", seed, (int)mode, what);
+            if (++failures >= 10) {
+                break;
+            }
+        }
+        truncatedGames += truncated;
+    }
+
+    printf("board=%dx%d player=%s games=%llu truncated=%llu\n", GameBoard::WIDTH, GameBoard::HEIGHT,
+           autoplay ? "auto" : "random", (unsigned long long)games, (unsigned long long)truncatedGames);
+    printf("%s\n", failures ? "replays differ" : "replays match");
+    return failures ? 1 : 0;
+}
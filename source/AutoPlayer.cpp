@@ -0,0 +1,376 @@
+/**
+ * Autonomous player for the snake game
+ */
+
+#include <string.h>
+#include "AutoPlayer.h"
+
+// Stop taking shortcuts once the snake covers this share of the board, following
+// the cycle alone is then guaranteed to finish the game
+#define SHORTCUT_MAX_PERCENT 50
+
+// Without a cycle, steps a snake may go without eating before it heads for the food
+// whether or not the tail can still be followed, so it can't circle forever
+#define HUNGER_MAX_STEPS (2 * GRID_CELLS)
+
+#define UNREACHED 0xFFFF
+
+// Position of each cell along the Hamiltonian cycle and the direction to its successor
+// A cycle that crosses the edges of the board can't be followed with walls up.
+static uint16_t cycleOrder[GRID_CELLS];
+static Direction cycleDirection[GRID_CELLS];
+static bool hasCycle;
+static bool cycleWraps;
+
+// BFS arena: distance of every cell from the food and from the tail end, and the frontier queue
+// The cycle is shared once built, but each game planning at once needs its own arena.
+static HOST_THREAD_LOCAL uint16_t foodDistance[GRID_CELLS];
+static HOST_THREAD_LOCAL uint16_t tailDistance[GRID_CELLS];
+static HOST_THREAD_LOCAL uint16_t frontier[GRID_CELLS];
+
+// The body followed down the path to the food: its cells now, then the path's
+static HOST_THREAD_LOCAL uint16_t virtualBody[2 * GRID_CELLS];
+
+// Each snake's length when it last ate, and the steps it has taken since
+static HOST_THREAD_LOCAL uint16_t fedLength[MAX_PLAYERS];
+static HOST_THREAD_LOCAL uint16_t hungerSteps[MAX_PLAYERS];
+
+// Steps along the cycle from one cell to another
+static int cycleDistance(int from, int to) {
+    int distance = cycleOrder[to] - cycleOrder[from];
+    return distance < 0 ? distance + GRID_CELLS : distance;
+}
+
+// Map the index-th cell of a row-major walk to the board, optionally transposed
+static int walkCell(int major, int minor, bool transposed) {
+    Coords coords;
+    coords.row = transposed ? minor : major;
+    coords.col = transposed ? major : minor;
+    return GameBoard::cellIndex(coords);
+}
+
+// Build a Hamiltonian cycle into sequence, returning false if this board has none we can make
+// One that stays on the board is preferred, as it serves the walled mode as well.
+static bool buildCycle(uint16_t *sequence, bool *wraps) {
+    int majors = GameBoard::HEIGHT;
+    int minors = GameBoard::WIDTH;
+    bool transposed = false;
+    int length = 0;
+
+    if (majors % 2 != 0) {
+        transposed = true;
+        majors = GameBoard::WIDTH;
+        minors = GameBoard::HEIGHT;
+    }
+    if (majors % 2 == 0 && minors >= 2) {
+        // Boustrophedon over every column but the first, then back up the first column
+        for (int major = 0; major < majors; major++) {
+            for (int k = 1; k < minors; k++) {
+                sequence[length++] = walkCell(major, major % 2 == 0 ? k : minors - k, transposed);
+            }
+        }
+        for (int major = majors - 1; major >= 0; major--) {
+            sequence[length++] = walkCell(major, 0, transposed);
+        }
+        *wraps = false;
+        return true;
+    }
+
+    majors = GameBoard::HEIGHT;
+    minors = GameBoard::WIDTH;
+    transposed = false;
+    if (majors % minors == 0 || minors % majors == 0) {
+        // On a torus, run each row right from one column further left than the last.
+        // Dropping down from the end of a row lands on the start of the next, and
+        // after a multiple of the row length the walk wraps back to the first cell.
+        if (majors % minors != 0) {
+            transposed = true;
+            majors = GameBoard::WIDTH;
+            minors = GameBoard::HEIGHT;
+        }
+        for (int major = 0; major < majors; major++) {
+            int start = (minors - major % minors) % minors;
+            for (int k = 0; k < minors; k++) {
+                sequence[length++] = walkCell(major, (start + k) % minors, transposed);
+            }
+        }
+        *wraps = true;
+        return true;
+    }
+    return false;
+}
+
+// Precompute the Hamiltonian cycle for the board
+void autoPlayerInit(void) {
+    // frontier is free until the first plan, so borrow it for the cycle
+    uint16_t *sequence = frontier;
+    hasCycle = buildCycle(sequence, &cycleWraps);
+    if (!hasCycle) {
+        return;
+    }
+
+    for (int i = 0; i < GRID_CELLS; i++) {
+        int cell = sequence[i];
+        Coords next = GameBoard::coordsOf(sequence[(i + 1) % GRID_CELLS]);
+        cycleOrder[cell] = i;
+
+        for (int direction = 0; direction < DIRECTION_COUNT; direction++) {
+            if (coordsEqual(GameBoard::next(GameBoard::coordsOf(cell), (Direction)direction), next)) {
+                cycleDirection[cell] = (Direction)direction;
+            }
+        }
+    }
+}
+
+// Whether the cycle can be followed in the current game's mode
+// Obstacles sit on some of its cells, and walls cut it wherever it wraps.
+static bool cycleUsable(void) {
+    return hasCycle && game.mode != MODE_OBSTACLES && !(cycleWraps && game.mode == MODE_WALLS);
+}
+
+// Check if a step leaves the board, which only ends the game in the walled mode
+static bool crossesWall(Coords coords, Direction direction) {
+    Coords ahead;
+    ahead.row = coords.row + GameBoard::rowDelta(direction);
+    ahead.col = coords.col + GameBoard::colDelta(direction);
+    return game.mode == MODE_WALLS && GameBoard::isOutOfBounds(ahead);
+}
+
+// Breadth-first distances from a cell to every cell reachable through free cells
+static void measureDistances(int from, uint16_t *distance) {
+    for (int i = 0; i < GRID_CELLS; i++) {
+        distance[i] = UNREACHED;
+    }
+
+    int head = 0;
+    int tail = 0;
+    distance[from] = 0;
+    frontier[tail++] = from;
+
+    while (head < tail) {
+        int cell = frontier[head++];
+        Coords coords = GameBoard::coordsOf(cell);
+
+        for (int direction = 0; direction < DIRECTION_COUNT; direction++) {
+            Coords next = GameBoard::next(coords, (Direction)direction);
+            int nextCell = GameBoard::cellIndex(next);
+            if (distance[nextCell] != UNREACHED || coordsInSnake(next) ||
+                crossesWall(coords, (Direction)direction)) {
+                continue;
+            }
+            distance[nextCell] = distance[cell] + 1;
+            frontier[tail++] = nextCell;
+        }
+    }
+}
+
+// Flood the cells free in occupancy from start, counting them and noting if target is reached
+static int floodFrom(const uint32_t *occupancy, int start, int target, bool *reached) {
+    uint32_t seen[OCCUPANCY_WORDS];
+    memcpy(seen, occupancy, sizeof(seen));
+    seen[start >> 5] |= 1u << (start & 31);
+
+    int head = 0;
+    int tail = 0;
+    frontier[tail++] = start;
+    *reached = false;
+
+    while (head < tail) {
+        int cell = frontier[head++];
+        Coords coords = GameBoard::coordsOf(cell);
+
+        for (int direction = 0; direction < DIRECTION_COUNT; direction++) {
+            if (crossesWall(coords, (Direction)direction)) {
+                continue;
+            }
+            int nextCell = GameBoard::cellIndex(GameBoard::next(coords, (Direction)direction));
+            *reached = *reached || nextCell == target;
+            if ((seen[nextCell >> 5] >> (nextCell & 31)) & 1u) {
+                continue;
+            }
+            seen[nextCell >> 5] |= 1u << (nextCell & 31);
+            frontier[tail++] = nextCell;
+        }
+    }
+    return tail;
+}
+
+// Check if the snake can go the shortest way to the food from a neighbouring cell, eat it,
+// and still reach the end of its tail from there, so eating can't seal it in
+// The body is replayed along the path into virtualBody to find where it ends up.
+static bool safeToEat(const Snake *snake, int first) {
+    int length = snake->tailLength + 1;
+    int count = 0;
+    for (int segment = 0; segment < snake->tailLength; segment++) {
+        virtualBody[count++] = GameBoard::cellIndex(snake->tail[tailIndex(snake, segment)]);
+    }
+    virtualBody[count++] = GameBoard::cellIndex(snake->head);
+
+    // Walk down the food distances, which only ever fall by one a step
+    int cell = first;
+    virtualBody[count++] = cell;
+    while (foodDistance[cell] > 0) {
+        Coords coords = GameBoard::coordsOf(cell);
+        for (int direction = 0; direction < DIRECTION_COUNT; direction++) {
+            int nextCell = GameBoard::cellIndex(GameBoard::next(coords, (Direction)direction));
+            if (foodDistance[nextCell] == foodDistance[cell] - 1 && !crossesWall(coords, (Direction)direction)) {
+                cell = nextCell;
+                break;
+            }
+        }
+        virtualBody[count++] = cell;
+    }
+
+    // Eating keeps the whole body long one more cell
+    uint32_t occupancy[OCCUPANCY_WORDS];
+    memcpy(occupancy, game.occupancy, sizeof(occupancy));
+    for (int i = 0; i < length; i++) {
+        occupancy[virtualBody[i] >> 5] &= ~(1u << (virtualBody[i] & 31));
+    }
+    int start = count - length - 1;
+    for (int i = start; i < count; i++) {
+        occupancy[virtualBody[i] >> 5] |= 1u << (virtualBody[i] & 31);
+    }
+    if (game.occupiedCells + 1 >= GRID_CELLS) {
+        return true;
+    }
+
+    bool reached;
+    floodFrom(occupancy, cell, virtualBody[start], &reached);
+    return reached;
+}
+
+// Pick a turn without the cycle, putting staying alive ahead of eating
+// The snake takes the shortest way to the food only when it could still reach its tail
+// after eating. Otherwise it chases its tail the long way round, taking the move furthest
+// from the tail end (and then from the food), so the body spreads out and reshapes until
+// a safe way opens. Once it has gone HUNGER_MAX_STEPS without
+// eating it heads for the food regardless, so it can't circle forever.
+static Turn survivalTurn(int player) {
+    static const Turn turns[] = {TURN_NONE, TURN_LEFT, TURN_RIGHT};
+
+    const Snake *snake = &game.snakes[player];
+    int tailEnd = GameBoard::cellIndex(snake->tail[snake->tailStart]);
+    measureDistances(GameBoard::cellIndex(game.foodCoords), foodDistance);
+    measureDistances(tailEnd, tailDistance);
+    if (snake->tailLength != fedLength[player]) {
+        fedLength[player] = snake->tailLength;
+        hungerSteps[player] = 0;
+    }
+    bool hungry = ++hungerSteps[player] > HUNGER_MAX_STEPS;
+
+    // Nearest free cell to the food, tail-chasing move furthest from the tail end, and
+    // the move with the most room when the tail can't be reached at all
+    int eatTurn = -1;
+    int chaseTurn = -1;
+    int roomTurn = -1;
+    int eatDistance = UNREACHED;
+    int chaseTailDistance = -1;
+    int chaseFoodDistance = -1;
+    int bestRoom = -1;
+
+    for (int i = 0; i < 3; i++) {
+        Direction direction = applyTurn(snake->direction, turns[i]);
+        Coords next = GameBoard::next(snake->head, direction);
+        int cell = GameBoard::cellIndex(next);
+        if ((coordsInSnake(next) && cell != tailEnd) || crossesWall(snake->head, direction)) {
+            continue;
+        }
+
+        if (foodDistance[cell] < eatDistance) {
+            eatTurn = i;
+            eatDistance = foodDistance[cell];
+        }
+
+        bool reachesTail;
+        int room = floodFrom(game.occupancy, cell, tailEnd, &reachesTail);
+        // The tail end itself is left out of tailDistance, so it counts as the nearest
+        int fromTail = tailDistance[cell] == UNREACHED ? 0 : tailDistance[cell];
+        if ((reachesTail || cell == tailEnd) &&
+            (fromTail > chaseTailDistance ||
+             (fromTail == chaseTailDistance && (int)foodDistance[cell] > chaseFoodDistance))) {
+            chaseTurn = i;
+            chaseTailDistance = fromTail;
+            chaseFoodDistance = foodDistance[cell];
+        }
+        if (room > bestRoom) {
+            roomTurn = i;
+            bestRoom = room;
+        }
+    }
+
+    if (eatTurn >= 0 && (hungry || safeToEat(snake, GameBoard::cellIndex(GameBoard::next(
+                                        snake->head, applyTurn(snake->direction, turns[eatTurn])))))) {
+        return turns[eatTurn];
+    }
+    if (chaseTurn >= 0) {
+        return turns[chaseTurn];
+    }
+    return roomTurn >= 0 ? turns[roomTurn] : TURN_NONE;
+}
+
+// Pick the turn for a player's next step in the current game
+Turn autoPlayerTurn(int player) {
+    static const Turn turns[] = {TURN_NONE, TURN_LEFT, TURN_RIGHT};
+
+    const Snake *snake = &game.snakes[player];
+    int head = GameBoard::cellIndex(snake->head);
+    int tailEnd = GameBoard::cellIndex(snake->tail[snake->tailStart]);
+    int food = GameBoard::cellIndex(game.foodCoords);
+
+    // Plan without the cycle whenever its next step is backwards or blocked, as it is at
+    // the start of a game on a walled board; the end of the tail leaves in time
+    bool cycle = false;
+    if (cycleUsable()) {
+        Direction along = cycleDirection[head];
+        int ahead = GameBoard::cellIndex(GameBoard::next(snake->head, along));
+        bool open = !crossesWall(snake->head, along) &&
+                    (ahead == tailEnd || !coordsInSnake(GameBoard::coordsOf(ahead)));
+        for (int i = 0; i < 3; i++) {
+            cycle = cycle || (open && applyTurn(snake->direction, turns[i]) == along);
+        }
+    }
+    if (!cycle) {
+        return survivalTurn(player);
+    }
+
+    bool shortcuts = game.occupiedCells * 100 < GRID_CELLS * SHORTCUT_MAX_PERCENT;
+    if (shortcuts) {
+        measureDistances(GameBoard::cellIndex(game.foodCoords), foodDistance);
+    }
+
+    // Default to the cycle
+    Turn bestTurn = TURN_NONE;
+    int bestDistance = UNREACHED;
+    bool found = false;
+
+    for (int i = 0; i < 3; i++) {
+        Direction direction = applyTurn(snake->direction, turns[i]);
+        Coords next = GameBoard::next(snake->head, direction);
+        int cell = GameBoard::cellIndex(next);
+
+        if (direction == cycleDirection[head] && !found) {
+            bestTurn = turns[i];
+        }
+        if (!shortcuts || coordsInSnake(next) || crossesWall(snake->head, direction)) {
+            continue;
+        }
+
+        // Stay ahead of the tail along the cycle so the body never blocks the way home,
+        // and never jump past the food so every step brings it closer
+        if (cycleDistance(head, cell) >= cycleDistance(head, tailEnd) ||
+            cycleDistance(head, cell) > cycleDistance(head, food)) {
+            continue;
+        }
+
+        // Closest to the food wins, the cycle breaking ties
+        if (!found || foodDistance[cell] < bestDistance ||
+            (foodDistance[cell] == bestDistance && direction == cycleDirection[head])) {
+            bestTurn = turns[i];
+            bestDistance = foodDistance[cell];
+            found = true;
+        }
+    }
+
+    return bestTurn;
+}
@@ -0,0 +1,18 @@
+/**
+ * Autonomous player for the snake game
+ *
+ * Follows a Hamiltonian cycle of the board, built once at start-up, and takes
+ * BFS shortcuts towards the food whenever they cannot trap the snake. All
+ * working storage is static, so planning never touches the heap.
+ */
+
+#ifndef SNAKE_AUTO_PLAYER_H
+#define SNAKE_AUTO_PLAYER_H
+
+#include "Game.h"
+
+// Function declarations
+void autoPlayerInit(void);
+Turn autoPlayerTurn(int player);
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ * Compile-time grid geometry for the snake game
+ *
+ * Board<W, H> turns the grid dimensions into constants so that wraparound
+ * folds to a bit mask on power-of-two boards and every neighbour lookup is a
+ * single read from a table built by the compiler.
+ */
+
+#ifndef SNAKE_BOARD_H
+#define SNAKE_BOARD_H
+
+#include <stdint.h>
+
+// Direction definitions, kept to a byte so they pack into the game state
+typedef enum : uint8_t {
+    UP,
+    DOWN,
+    LEFT,
+    RIGHT
+} Direction;
+
+#define DIRECTION_COUNT 4
+
+// Coordinates on the grid
+typedef struct {
+    int8_t row;
+    int8_t col;
+} Coords;
+
+static_assert(sizeof(Coords) == 2 && alignof(Coords) == 1, "Coords must pack into two bytes");
+
+// A list of ints, built in log(N) template depth so large boards don't hit the recursion limit
+template <int... I> struct IndexList {};
+
+template <class A, class B> struct ConcatIndices;
+
+template <int... A, int... B> struct ConcatIndices<IndexList<A...>, IndexList<B...>> {
+    typedef IndexList<A..., (int)(sizeof...(A)) + B...> type;
+};
+
+template <int N> struct MakeIndices {
+    typedef typename ConcatIndices<typename MakeIndices<N / 2>::type,
+                                   typename MakeIndices<N - N / 2>::type>::type type;
+};
+
+template <> struct MakeIndices<0> {
+    typedef IndexList<> type;
+};
+
+template <> struct MakeIndices<1> {
+    typedef IndexList<0> type;
+};
+
+// Expands BoardT::neighbourOf() over every (cell, direction) pair
+template <class BoardT, class Indices> struct NeighbourTable;
+
+template <class BoardT, int... I> struct NeighbourTable<BoardT, IndexList<I...>> {
+    static constexpr Coords cells[sizeof...(I)] = {BoardT::neighbourOf(I)...};
+};
+
+template <class BoardT, int... I>
+constexpr Coords NeighbourTable<BoardT, IndexList<I...>>::cells[sizeof...(I)];
+
+// Grid of W columns by H rows that wraps around at every edge
+template <int W, int H> struct Board {
+    static constexpr int WIDTH = W;
+    static constexpr int HEIGHT = H;
+    static constexpr int CELLS = W * H;
+
+    static_assert(W > 0 && H > 0 && W <= 127 && H <= 127, "Board must fit in Coords");
+
+    static constexpr bool isPowerOfTwo(int n) { return (n & (n - 1)) == 0; }
+
+    // Fold a row or column that is at most one step off the board back onto it
+    static constexpr int wrap(int value, int size) {
+        return isPowerOfTwo(size) ? (value & (size - 1))
+                                  : (value < 0 ? size - 1 : (value >= size ? 0 : value));
+    }
+
+    static constexpr int rowDelta(int direction) {
+        return direction == UP ? -1 : (direction == DOWN ? 1 : 0);
+    }
+
+    static constexpr int colDelta(int direction) {
+        return direction == LEFT ? -1 : (direction == RIGHT ? 1 : 0);
+    }
+
+    // Entry of the neighbour table: index is cell * DIRECTION_COUNT + direction
+    static constexpr Coords neighbourOf(int index) {
+        return Coords{(int8_t)wrap(index / DIRECTION_COUNT / W + rowDelta(index % DIRECTION_COUNT), H),
+                      (int8_t)wrap(index / DIRECTION_COUNT % W + colDelta(index % DIRECTION_COUNT), W)};
+    }
+
+    typedef NeighbourTable<Board, typename MakeIndices<CELLS * DIRECTION_COUNT>::type> Neighbours;
+
+    static constexpr int cellIndex(Coords coords) { return coords.row * W + coords.col; }
+
+    static Coords coordsOf(int cell) {
+        Coords coords;
+        coords.row = cell / W;
+        coords.col = cell % W;
+        return coords;
+    }
+
+    static bool isOutOfBounds(Coords coords) {
+        return (coords.row < 0 || coords.row >= H || coords.col < 0 || coords.col >= W);
+    }
+
+    // The cell one step away in the given direction, already wrapped
+    static Coords next(Coords coords, Direction direction) {
+        return Neighbours::cells[cellIndex(coords) * DIRECTION_COUNT + direction];
+    }
+};
+
+#endif
@@ -0,0 +1,37 @@
+/**
+ * Display backends for the snake game
+ *
+ * The game draws cells into the selected backend, which keeps its own back
+ * buffer and only pushes it out, whole, when a frame is presented.
+ */
+
+#ifndef SNAKE_DISPLAY_H
+#define SNAKE_DISPLAY_H
+
+#include <stdint.h>
+#include "Board.h"
+
+// NeoPixel panel configuration
+// Most panels are wired in a zigzag, every other row running right to left.
+#define NEOPIXEL_SERPENTINE 1
+#define NEOPIXEL_MAX_LEVEL 32
+
+// What the game needs from a display
+typedef struct {
+    void (*init)(void);
+    void (*setCell)(Coords coords, uint8_t brightness);
+    void (*clear)(void);
+    // Push the back buffer out as one complete frame
+    void (*present)(void);
+} DisplayBackend;
+
+extern const DisplayBackend ledMatrixDisplay;
+extern const DisplayBackend neoPixelDisplay;
+
+// Text scrolled through a backend in steps of one column, for callers to time themselves
+char *appendText(char *out, const char *text);
+char *appendNumber(char *out, uint32_t value);
+int textColumns(const char *text);
+void drawText(const DisplayBackend *backend, const char *text, int column);
+
+#endif
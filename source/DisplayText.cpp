@@ -0,0 +1,75 @@
+/**
+ * Scrolling text drawn through any display backend
+ *
+ * Text is made up from the system font one glyph column at a time, so a
+ * caller can step a scroll from its own timer instead of blocking in
+ * uBit.display.scroll(), and it shows on a NeoPixel panel as well as the
+ * LED matrix.
+ */
+
+#include <string.h>
+#include "MicroBit.h"
+#include "Display.h"
+#include "Game.h"
+
+// Glyphs are set one blank column apart, like the matrix's own scrolling
+#define TEXT_CHAR_COLUMNS (BITMAP_FONT_WIDTH + 1)
+
+// Copy text onto the end of out, returning the new end
+char *appendText(char *out, const char *text) {
+    while (*text) {
+        *out++ = *text++;
+    }
+    *out = 0;
+    return out;
+}
+
+// Write value in decimal onto the end of out, returning the new end
+char *appendNumber(char *out, uint32_t value) {
+    char digits[10];
+    int count = 0;
+    do {
+        digits[count++] = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    while (count > 0) {
+        *out++ = digits[--count];
+    }
+    *out = 0;
+    return out;
+}
+
+// Steps it takes text to scroll in from the right edge and off the left
+int textColumns(const char *text) {
+    return (int)strlen(text) * TEXT_CHAR_COLUMNS + GameBoard::WIDTH;
+}
+
+// Light the cells of text scrolled column steps in from the right edge, centred on the rows
+void drawText(const DisplayBackend *backend, const char *text, int column) {
+    BitmapFont font = BitmapFont::getSystemFont();
+    int length = (int)strlen(text);
+    int top = GameBoard::HEIGHT > BITMAP_FONT_HEIGHT ? (GameBoard::HEIGHT - BITMAP_FONT_HEIGHT) / 2 : 0;
+
+    for (int x = 0; x < GameBoard::WIDTH; x++) {
+        int textColumn = column + x - GameBoard::WIDTH;
+        if (textColumn < 0) {
+            continue;
+        }
+        int index = textColumn / TEXT_CHAR_COLUMNS;
+        int glyphColumn = textColumn % TEXT_CHAR_COLUMNS;
+        if (index >= length) {
+            return;
+        }
+        if (glyphColumn == BITMAP_FONT_WIDTH) {
+            continue;
+        }
+
+        const uint8_t *glyph = font.get(text[index]);
+        for (int row = 0; row < BITMAP_FONT_HEIGHT && top + row < GameBoard::HEIGHT; row++) {
+            if (glyph[row] & (0x10 >> glyphColumn)) {
+                Coords coords = {(int8_t)(top + row), (int8_t)x};
+                backend->setCell(coords, 255);
+            }
+        }
+    }
+}
@@ -0,0 +1,141 @@
+/**
+ * Append-only record logs in dedicated flash pages
+ *
+ * Each record is a magic word, a sequence number and the payload. The magic
+ * word is written last, so a record torn by a reset is never read back; its
+ * slot is neither valid nor erased, and the next append skips to a fresh page.
+ */
+
+#include <string.h>
+#include "MicroBit.h"
+#include "FlashLog.h"
+
+extern MicroBit uBit;
+
+#define FLASH_LOG_MAGIC 0x534E4B4Cu
+#define FLASH_ERASED_WORD 0xFFFFFFFFu
+
+// Words written per flash call while copying a payload
+#define FLASH_LOG_COPY_WORDS 16
+
+// Function declarations
+static int recordWords(const FlashLog *log);
+static int slotsPerPage(const FlashLog *log);
+static const volatile uint32_t *slotAddress(const FlashLog *log, int slot);
+static bool slotErased(const FlashLog *log, int slot);
+static bool findNewest(const FlashLog *log, int *slot, uint32_t *sequence);
+static int writeWords(const volatile uint32_t *dst, const uint32_t *src, int words);
+
+// Words one record takes: magic, sequence and the payload rounded up to whole words
+static int recordWords(const FlashLog *log) {
+    return 2 + (log->payloadBytes + 3) / 4;
+}
+
+// Records fit in a page; none straddles two, so erasing a page leaves the rest whole
+static int slotsPerPage(const FlashLog *log) {
+    return FLASH_PAGE_WORDS / recordWords(log);
+}
+
+// Where a slot of the log starts
+static const volatile uint32_t *slotAddress(const FlashLog *log, int slot) {
+    int perPage = slotsPerPage(log);
+    return log->region + (slot / perPage) * FLASH_PAGE_WORDS + (slot % perPage) * recordWords(log);
+}
+
+// Check if a slot can be written without an erase
+static bool slotErased(const FlashLog *log, int slot) {
+    const volatile uint32_t *record = slotAddress(log, slot);
+    for (int i = 0; i < recordWords(log); i++) {
+        if (record[i] != FLASH_ERASED_WORD) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Find the record with the highest sequence number, compared so it survives wrapping
+static bool findNewest(const FlashLog *log, int *slot, uint32_t *sequence) {
+    bool found = false;
+    int slots = slotsPerPage(log) * log->pages;
+    for (int i = 0; i < slots; i++) {
+        const volatile uint32_t *record = slotAddress(log, i);
+        if (record[0] != FLASH_LOG_MAGIC) {
+            continue;
+        }
+        if (!found || (int32_t)(record[1] - *sequence) > 0) {
+            *slot = i;
+            *sequence = record[1];
+            found = true;
+        }
+    }
+    return found;
+}
+
+// Program words into erased flash, returning the flash driver's status
+static int writeWords(const volatile uint32_t *dst, const uint32_t *src, int words) {
+    return uBit.flash.write((uint32_t)(uintptr_t)dst, (uint32_t *)src, words);
+}
+
+// Copy the newest record's payload out, returning false if the log is empty
+bool flashLogRead(const FlashLog *log, void *payload) {
+    int slot;
+    uint32_t sequence;
+    if (!findNewest(log, &slot, &sequence)) {
+        return false;
+    }
+
+    const volatile uint32_t *words = slotAddress(log, slot) + 2;
+    uint8_t *out = (uint8_t *)payload;
+    for (int offset = 0; offset < log->payloadBytes; offset += 4) {
+        uint32_t word = words[offset / 4];
+        int bytes = log->payloadBytes - offset < 4 ? log->payloadBytes - offset : 4;
+        memcpy(out + offset, &word, bytes);
+    }
+    return true;
+}
+
+// Append a record after the newest, erasing the next page only once the log reaches it
+// Returns MICROBIT_OK, or the flash driver's error from the erase or write that failed.
+int flashLogAppend(const FlashLog *log, const void *payload) {
+    int perPage = slotsPerPage(log);
+    int slots = perPage * log->pages;
+    int newest = slots - 1;
+    uint32_t sequence = 0;
+    findNewest(log, &newest, &sequence);
+
+    int slot = (newest + 1) % slots;
+    if (!slotErased(log, slot)) {
+        // Start the page after the newest record's, so the newest survives while this is written
+        int page = (newest / perPage + 1) % log->pages;
+        slot = page * perPage;
+        int status = uBit.flash.erase((uint32_t)(uintptr_t)(log->region + page * FLASH_PAGE_WORDS));
+        if (status != MICROBIT_OK) {
+            return status;
+        }
+    }
+
+    const volatile uint32_t *record = slotAddress(log, slot);
+    uint32_t next = sequence + 1;
+    int status = writeWords(record + 1, &next, 1);
+    if (status != MICROBIT_OK) {
+        return status;
+    }
+
+    uint32_t buffer[FLASH_LOG_COPY_WORDS];
+    const uint8_t *in = (const uint8_t *)payload;
+    for (int offset = 0; offset < log->payloadBytes; offset += sizeof(buffer)) {
+        int bytes = log->payloadBytes - offset;
+        if (bytes > (int)sizeof(buffer)) {
+            bytes = sizeof(buffer);
+        }
+        memset(buffer, 0xFF, sizeof(buffer));
+        memcpy(buffer, in + offset, bytes);
+        status = writeWords(record + 2 + offset / 4, buffer, (bytes + 3) / 4);
+        if (status != MICROBIT_OK) {
+            return status;
+        }
+    }
+
+    uint32_t magic = FLASH_LOG_MAGIC;
+    return writeWords(record, &magic, 1);
+}
@@ -0,0 +1,40 @@
+/**
+ * Append-only record logs in dedicated flash pages
+ *
+ * A log owns whole pages of program flash, set aside at build time and apart
+ * from the micro:bit key/value storage page. Records are appended one after
+ * another, each stamped with a sequence number, and a page is only erased
+ * when the log wraps back round onto it. A save is then a single write, and
+ * a page takes one erase per pageful of records rather than one per save.
+ * Boot scans the log for the newest record.
+ */
+
+#ifndef SNAKE_FLASH_LOG_H
+#define SNAKE_FLASH_LOG_H
+
+#include <stdint.h>
+
+// nRF52833 flash page, the unit of erase
+#define FLASH_PAGE_BYTES 4096
+#define FLASH_PAGE_WORDS (FLASH_PAGE_BYTES / 4)
+
+#define FLASH_LOG_STRINGIFY(x) #x
+
+// Set aside whole pages of program flash for a log
+// Reads go through volatile so the compiler can't fold them to the zeros it was flashed with.
+#define FLASH_LOG_REGION(name, pages)                                                           \
+    static const volatile uint32_t name[(pages) * FLASH_PAGE_WORDS]                             \
+        __attribute__((aligned(FLASH_PAGE_BYTES), used, section(".rodata." FLASH_LOG_STRINGIFY(name)))) = {0}
+
+// A log of fixed-size records over some pages of a region
+typedef struct {
+    const volatile uint32_t *region;
+    uint16_t pages;
+    uint16_t payloadBytes;
+} FlashLog;
+
+// Function declarations
+bool flashLogRead(const FlashLog *log, void *payload);
+int flashLogAppend(const FlashLog *log, const void *payload);
+
+#endif
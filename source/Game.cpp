@@ -0,0 +1,498 @@
+/**
+ * Platform-independent core of the snake game
+ *
+ * Everything in here only touches the global game state and the Platform
+ * hooks, so it runs the same on the micro:bit and in the host simulator.
+ */
+
+#include <string.h>
+#include "Game.h"
+
+// Global variables for game state
+HOST_THREAD_LOCAL Game game;
+
+// Hooks supplied by whatever is running the game
+static HOST_THREAD_LOCAL const Platform *platform;
+
+// Where foods that aren't out are kept, off the board
+static const Coords NO_FOOD = {-1, -1};
+
+// Rules shared by every mode; a mode derives from ModeRules<itself> and hides the hooks it changes
+// The step code calls the hooks through Rules, so each mode gets its own copy of it with
+// its hooks inlined, and the default hooks fold away entirely.
+template <class Rules> struct ModeRules {
+    // Set up the board for a new game once the snakes are placed
+    static void setup(void) {
+        placeFood();
+    }
+
+    // Check if a snake's next step takes it off the board rather than wrapping round
+    static bool leavesBoard(const Snake *snake) {
+        return false;
+    }
+
+    // Check if a cell holds food
+    static bool isFood(Coords coords) {
+        return coordsEqual(coords, game.foodCoords);
+    }
+
+    // Put out new food in place of what was just eaten
+    static void replaceFood(Coords eaten) {
+        placeFood();
+    }
+
+    static void planStep(int player, StepResult *step);
+    static void applyStep(int player, const StepResult *step);
+    static void stepGame(void);
+};
+
+// The classic game, wrapping round at every edge
+struct WrapRules : ModeRules<WrapRules> {};
+
+// Running into an edge is a collision
+struct WallRules : ModeRules<WallRules> {
+    static bool leavesBoard(const Snake *snake) {
+        Coords ahead;
+        ahead.row = snake->head.row + GameBoard::rowDelta(snake->direction);
+        ahead.col = snake->head.col + GameBoard::colDelta(snake->direction);
+        return GameBoard::isOutOfBounds(ahead);
+    }
+};
+
+// Obstacles scattered over the board; they sit in the occupancy bitboard, so hitting
+// one is an ordinary collision and the step needs no extra check
+struct ObstacleRules : ModeRules<ObstacleRules> {
+    static void setup(void);
+};
+
+// FOOD_COUNT foods out at once
+struct MultiFoodRules : ModeRules<MultiFoodRules> {
+    static void setup(void);
+    static bool isFood(Coords coords);
+    static void replaceFood(Coords eaten);
+};
+
+// Entry points of each mode's instantiation, indexed by GameMode
+typedef struct {
+    void (*setup)(void);
+    void (*planStep)(int player, StepResult *step);
+    void (*applyStep)(int player, const StepResult *step);
+    void (*stepGame)(void);
+} ModeEntry;
+
+static const ModeEntry modes[MODE_COUNT] = {
+    {WrapRules::setup, WrapRules::planStep, WrapRules::applyStep, WrapRules::stepGame},
+    {WallRules::setup, WallRules::planStep, WallRules::applyStep, WallRules::stepGame},
+    {ObstacleRules::setup, ObstacleRules::planStep, ObstacleRules::applyStep, ObstacleRules::stepGame},
+    {MultiFoodRules::setup, MultiFoodRules::planStep, MultiFoodRules::applyStep, MultiFoodRules::stepGame},
+};
+
+// Attach the game core to a platform
+void setPlatform(const Platform *newPlatform) {
+    platform = newPlatform;
+}
+
+// Initialize the game state
+void initGame(uint32_t seed, int players, GameMode mode) {
+    // xorshift32 must never be seeded with zero
+    game.seed = seed;
+    game.rngState = seed ? seed : 0x2545F491;
+
+    // Initialize the snakes, spread down the middle column; one player starts in the centre
+    game.playerCount = players;
+    game.mode = mode;
+    memset(game.occupancy, 0, sizeof(game.occupancy));
+    memset(game.obstacles, 0, sizeof(game.obstacles));
+    game.occupiedCells = 0;
+    for (int i = 0; i < FOOD_COUNT - 1; i++) {
+        game.extraFood[i] = NO_FOOD;
+    }
+
+    for (int player = 0; player < players; player++) {
+        Snake *snake = &game.snakes[player];
+        int8_t row = (player * GameBoard::HEIGHT) / players + GameBoard::HEIGHT / (2 * players);
+
+        snake->head.row = row;
+        snake->head.col = 2;
+        snake->tail[0].row = row;
+        snake->tail[0].col = 1;
+        snake->tailStart = 0;
+        snake->tailLength = 1;
+        snake->direction = RIGHT;
+
+        // Add the initial body to the occupancy bitboard
+        setOccupied(snake->head, true);
+        setOccupied(snake->tail[0], true);
+        game.occupiedCells += 2;
+    }
+
+    // Initialize game state
+    game.speed = 1;
+    game.status = ONGOING;
+    game.score = 0;
+    game.loser = 0;
+
+    // Lay out whatever the mode adds to the board, and the first food
+    modes[mode].setup();
+}
+
+// Check if two coordinates are equal
+bool coordsEqual(Coords a, Coords b) {
+    return (a.row == b.row && a.col == b.col);
+}
+
+// Map a tail segment (0 is the end of the tail) to its slot in the ring buffer
+int tailIndex(const Snake *snake, int segment) {
+    int index = snake->tailStart + segment;
+    if (index >= MAX_SNAKE_LENGTH) {
+        index -= MAX_SNAKE_LENGTH;
+    }
+    return index;
+}
+
+// Mark or clear a cell in the occupancy bitboard
+void setOccupied(Coords coords, bool occupied) {
+    int cell = GameBoard::cellIndex(coords);
+    uint32_t mask = 1u << (cell & 31);
+
+    if (occupied) {
+        game.occupancy[cell >> 5] |= mask;
+    } else {
+        game.occupancy[cell >> 5] &= ~mask;
+    }
+}
+
+// Check if coordinates are in any snake's body
+bool coordsInSnake(Coords coords) {
+    int cell = GameBoard::cellIndex(coords);
+    return (game.occupancy[cell >> 5] >> (cell & 31)) & 1u;
+}
+
+// Advance the per-game xorshift32 generator
+uint32_t nextRandom(void) {
+    uint32_t x = game.rngState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    game.rngState = x;
+    return x;
+}
+
+// Check if coordinates are the head of any snake
+bool coordsIsHead(Coords coords) {
+    for (int player = 0; player < game.playerCount; player++) {
+        if (coordsEqual(coords, game.snakes[player].head)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Check if coordinates hold any of the food out
+bool coordsIsFood(Coords coords) {
+    return MultiFoodRules::isFood(coords);
+}
+
+// Check if coordinates are an obstacle
+bool coordsIsObstacle(Coords coords) {
+    int cell = GameBoard::cellIndex(coords);
+    return (game.obstacles[cell >> 5] >> (cell & 31)) & 1u;
+}
+
+// Get random coordinates not occupied by a snake
+Coords getRandomCoords(void) {
+    // Pick the n-th free cell, scaling the random word instead of using modulo
+    uint32_t freeCells = GRID_CELLS - game.occupiedCells;
+    uint32_t n = (uint32_t)(((uint64_t)nextRandom() * freeCells) >> 32);
+
+    // Skip whole words of the bitboard, then walk the free bits of the chosen one
+    int cell = 0;
+    for (int word = 0; word < OCCUPANCY_WORDS; word++) {
+        uint32_t freeBits = ~game.occupancy[word];
+        if (word == OCCUPANCY_WORDS - 1 && GRID_CELLS % 32) {
+            freeBits &= (1u << (GRID_CELLS % 32)) - 1;
+        }
+
+        uint32_t count = __builtin_popcount(freeBits);
+        if (n < count) {
+            while (n--) {
+                freeBits &= freeBits - 1;
+            }
+            cell = word * 32 + __builtin_ctz(freeBits);
+            break;
+        }
+        n -= count;
+    }
+
+    return GameBoard::coordsOf(cell);
+}
+
+// Place food at a random location on the grid
+void placeFood(void) {
+    game.foodCoords = getRandomCoords();
+    platform->cellChanged(game.foodCoords);
+}
+
+// Get the next position a snake will move to
+Coords getNextMove(int player) {
+    const Snake *snake = &game.snakes[player];
+    return GameBoard::next(snake->head, snake->direction);
+}
+
+// Move a snake into its step's target, growing unless the step is a plain move
+void moveSnake(int player, const StepResult *step) {
+    Snake *snake = &game.snakes[player];
+    bool extend = step->outcome != MOVE;
+
+    // Free the end of the tail first, the head may be moving into it
+    if (!extend) {
+        setOccupied(step->vacated, false);
+        platform->cellChanged(step->vacated);
+    }
+    platform->cellChanged(snake->head);
+
+    // Append the previous head after the newest tail segment
+    snake->tail[tailIndex(snake, snake->tailLength)] = snake->head;
+
+    if (!extend) {
+        // Drop the end of the tail if not extending
+        snake->tailStart = tailIndex(snake, 1);
+    } else {
+        // Increase tail length
+        snake->tailLength++;
+        game.occupiedCells++;
+    }
+
+    // Move head to new coords
+    snake->head = step->target;
+    setOccupied(step->target, true);
+    platform->cellChanged(step->target);
+}
+
+// Work out a snake's next step: where the head goes, what it finds there and what it leaves
+// Filled in place rather than returned, so the fields are stored whole and read straight back.
+template <class Rules> void ModeRules<Rules>::planStep(int player, StepResult *step) {
+    const Snake *snake = &game.snakes[player];
+    step->target = GameBoard::next(snake->head, snake->direction);
+    step->vacated = snake->tail[snake->tailStart];
+
+    // Moving into a body is a collision, except into the end of this snake's own tail,
+    // which leaves as the head arrives
+    if (Rules::leavesBoard(snake) || (coordsInSnake(step->target) && !coordsEqual(step->target, step->vacated))) {
+        step->outcome = COLLISION;
+    } else if (Rules::isFood(step->target)) {
+        // The last free cell is being eaten, the grid is full
+        step->outcome = game.occupiedCells + 1 >= GRID_CELLS ? FULL : EAT;
+    } else {
+        step->outcome = MOVE;
+    }
+}
+
+// Apply a planned step to the snake and the game
+template <class Rules> void ModeRules<Rules>::applyStep(int player, const StepResult *step) {
+    platform->stepped(player, step);
+
+    switch (step->outcome) {
+        case COLLISION:
+            game.status = LOST;
+            game.loser = player;
+            break;
+
+        case FULL:
+            moveSnake(player, step);
+            game.status = WON;
+            break;
+
+        case EAT:
+            moveSnake(player, step);
+            Rules::replaceFood(step->target);
+            game.score++;
+            if (game.score % SPEED_POINTS_PER_LEVEL == 0 && game.speed < SPEED_LEVELS) {
+                game.speed++;
+            }
+            break;
+
+        case MOVE:
+            moveSnake(player, step);
+            break;
+    }
+}
+
+// Perform a single game step, moving each snake in player order
+template <class Rules> void ModeRules<Rules>::stepGame(void) {
+    for (int player = 0; player < game.playerCount && game.status == ONGOING; player++) {
+        // Process any pending turn
+        turnSnake(player, platform->nextTurn(player));
+
+        // Work the step out once, then apply it
+        StepResult step;
+        Rules::planStep(player, &step);
+        Rules::applyStep(player, &step);
+    }
+}
+
+// Check if any snake starts in a row
+static bool rowHasSnake(int row) {
+    for (int player = 0; player < game.playerCount; player++) {
+        if (game.snakes[player].head.row == row) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Scatter the obstacles from the game's PRNG, keeping clear of the rows the snakes start in
+// Placement gives up after a few tries per cell on boards too small to fit them all.
+void ObstacleRules::setup(void) {
+    int placed = 0;
+    for (int tries = 0; placed < OBSTACLE_COUNT && tries < 4 * GRID_CELLS; tries++) {
+        if (game.occupiedCells + 1 >= GRID_CELLS) {
+            break;
+        }
+        Coords coords = getRandomCoords();
+        if (rowHasSnake(coords.row)) {
+            continue;
+        }
+
+        int cell = GameBoard::cellIndex(coords);
+        game.obstacles[cell >> 5] |= 1u << (cell & 31);
+        setOccupied(coords, true);
+        game.occupiedCells++;
+        placed++;
+    }
+    placeFood();
+}
+
+// Pick an empty cell for a new food, one no snake or other food is on; NO_FOOD if there are none
+// The foods out are briefly marked occupied, so getRandomCoords() passes over them.
+static Coords pickFoodCell(void) {
+    Coords hidden[FOOD_COUNT];
+    int hiddenCount = 0;
+    for (int i = 0; i < FOOD_COUNT; i++) {
+        Coords food = i == 0 ? game.foodCoords : game.extraFood[i - 1];
+        if (!GameBoard::isOutOfBounds(food) && !coordsInSnake(food)) {
+            setOccupied(food, true);
+            hidden[hiddenCount++] = food;
+        }
+    }
+
+    Coords picked = NO_FOOD;
+    if (game.occupiedCells + hiddenCount < GRID_CELLS) {
+        game.occupiedCells += hiddenCount;
+        picked = getRandomCoords();
+        game.occupiedCells -= hiddenCount;
+    }
+
+    for (int i = 0; i < hiddenCount; i++) {
+        setOccupied(hidden[i], false);
+    }
+    return picked;
+}
+
+// Put out the first food, then the extras
+void MultiFoodRules::setup(void) {
+    placeFood();
+    for (int i = 0; i < FOOD_COUNT - 1; i++) {
+        game.extraFood[i] = pickFoodCell();
+        if (!GameBoard::isOutOfBounds(game.extraFood[i])) {
+            platform->cellChanged(game.extraFood[i]);
+        }
+    }
+}
+
+// Check if a cell holds any of the foods out
+bool MultiFoodRules::isFood(Coords coords) {
+    if (coordsEqual(coords, game.foodCoords)) {
+        return true;
+    }
+    for (int i = 0; i < FOOD_COUNT - 1; i++) {
+        if (coordsEqual(coords, game.extraFood[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Replace the food just eaten, keeping foodCoords filled while any food is out
+void MultiFoodRules::replaceFood(Coords eaten) {
+    Coords *slot = &game.foodCoords;
+    for (int i = 0; i < FOOD_COUNT - 1; i++) {
+        if (coordsEqual(game.extraFood[i], eaten)) {
+            slot = &game.extraFood[i];
+        }
+    }
+    *slot = pickFoodCell();
+    if (!GameBoard::isOutOfBounds(*slot)) {
+        platform->cellChanged(*slot);
+    }
+
+    // The autoplayer and the single-food code paths chase foodCoords
+    for (int i = 0; i < FOOD_COUNT - 1 && GameBoard::isOutOfBounds(game.foodCoords); i++) {
+        game.foodCoords = game.extraFood[i];
+        game.extraFood[i] = NO_FOOD;
+    }
+}
+
+// Work out a snake's next step in the current mode
+void planStep(int player, StepResult *step) {
+    modes[game.mode].planStep(player, step);
+}
+
+// Apply a planned step in the current mode
+void applyStep(int player, const StepResult *step) {
+    modes[game.mode].applyStep(player, step);
+}
+
+// Direction each turn leads to, indexed by [direction][turn]
+static constexpr Direction TURN_RESULT[DIRECTION_COUNT][TURN_COUNT] = {
+    /* UP */ {UP, LEFT, RIGHT},
+    /* DOWN */ {DOWN, RIGHT, LEFT},
+    /* LEFT */ {LEFT, DOWN, UP},
+    /* RIGHT */ {RIGHT, UP, DOWN},
+};
+
+// Turn that leads from one direction to another, indexed by [from][to]; reversing isn't a turn
+static constexpr Turn TURN_TOWARD[DIRECTION_COUNT][DIRECTION_COUNT] = {
+    /* UP */ {TURN_NONE, TURN_NONE, TURN_LEFT, TURN_RIGHT},
+    /* DOWN */ {TURN_NONE, TURN_NONE, TURN_RIGHT, TURN_LEFT},
+    /* LEFT */ {TURN_RIGHT, TURN_LEFT, TURN_NONE, TURN_NONE},
+    /* RIGHT */ {TURN_LEFT, TURN_RIGHT, TURN_NONE, TURN_NONE},
+};
+
+static_assert(TURN_RESULT[UP][TURN_LEFT] == LEFT && TURN_RESULT[LEFT][TURN_RIGHT] == UP &&
+              TURN_RESULT[DOWN][TURN_LEFT] == RIGHT && TURN_RESULT[RIGHT][TURN_RIGHT] == DOWN,
+              "Left turns go anticlockwise and right turns clockwise");
+static_assert(TURN_TOWARD[UP][TURN_RESULT[UP][TURN_LEFT]] == TURN_LEFT &&
+              TURN_TOWARD[RIGHT][TURN_RESULT[RIGHT][TURN_RIGHT]] == TURN_RIGHT,
+              "TURN_TOWARD must invert TURN_RESULT");
+
+// Work out the direction a turn leads to
+Direction applyTurn(Direction direction, Turn turn) {
+    return TURN_RESULT[direction][turn];
+}
+
+// The turn that points a snake heading one way towards another
+Turn turnToward(Direction from, Direction to) {
+    return TURN_TOWARD[from][to];
+}
+
+// Turn a snake in a new direction
+void turnSnake(int player, Turn turn) {
+    Snake *snake = &game.snakes[player];
+    snake->direction = applyTurn(snake->direction, turn);
+}
+
+// Perform a single game step in the current mode
+// The default mode is called directly, so its step code inlines here as it always has.
+void stepGame(void) {
+    if (game.mode == MODE_WRAP) {
+        WrapRules::stepGame();
+    } else {
+        modes[game.mode].stepGame();
+    }
+}
+
+// Step length in microseconds at the current speed level
+uint32_t getStepLengthUs(void) {
+    return SpeedCurve::lengthUs[game.speed - 1];
+}
@@ -0,0 +1,212 @@
+/**
+ * Platform-independent core of the snake game
+ *
+ * The game logic only talks to the outside world through the Platform hooks,
+ * so the same code drives the micro:bit and the headless host simulator.
+ */
+
+#ifndef SNAKE_GAME_H
+#define SNAKE_GAME_H
+
+#include <stdint.h>
+#include "Board.h"
+
+// Game constants
+#ifndef GRID_WIDTH
+#define GRID_WIDTH 5
+#endif
+
+#ifndef GRID_HEIGHT
+#define GRID_HEIGHT 5
+#endif
+
+#ifndef MAX_PLAYERS
+#define MAX_PLAYERS 4
+#endif
+
+// Speed curve: the step starts at SPEED_START_MS and each level shrinks it to
+// SPEED_DECAY_PERMILLE of the level before, until it bottoms out at SPEED_FLOOR_MS.
+// The game goes up a level every SPEED_POINTS_PER_LEVEL points.
+#ifndef SPEED_START_MS
+#define SPEED_START_MS 1000
+#endif
+
+#ifndef SPEED_FLOOR_MS
+#define SPEED_FLOOR_MS 50
+#endif
+
+#ifndef SPEED_DECAY_PERMILLE
+#define SPEED_DECAY_PERMILLE 900
+#endif
+
+#ifndef SPEED_POINTS_PER_LEVEL
+#define SPEED_POINTS_PER_LEVEL 1
+#endif
+
+#define SPEED_LEVELS 32
+
+// Obstacles scattered over the board in MODE_OBSTACLES, and foods out at once in MODE_MULTI_FOOD
+#ifndef OBSTACLE_COUNT
+#define OBSTACLE_COUNT 3
+#endif
+
+#ifndef FOOD_COUNT
+#define FOOD_COUNT 3
+#endif
+
+// The host fuzzer runs a separate game on every core, so there the core's state is per thread
+#ifdef SNAKE_THREADED_CORE
+#define HOST_THREAD_LOCAL thread_local
+#else
+#define HOST_THREAD_LOCAL
+#endif
+
+// Turn definitions
+typedef enum : uint8_t {
+    TURN_NONE,
+    TURN_LEFT,
+    TURN_RIGHT
+} Turn;
+
+#define TURN_COUNT 3
+
+// Game status
+typedef enum : uint8_t {
+    ONGOING,
+    WON,
+    LOST
+} GameStatus;
+
+// Game modes, picked when a game starts
+// Each mode's step code is its own template instantiation, so a mode's rules
+// cost nothing in the others.
+typedef enum : uint8_t {
+    MODE_WRAP,
+    MODE_WALLS,
+    MODE_OBSTACLES,
+    MODE_MULTI_FOOD
+} GameMode;
+
+#define MODE_COUNT 4
+
+// Step outcome
+typedef enum : uint8_t {
+    MOVE,
+    EAT,
+    COLLISION,
+    FULL
+} StepOutcome;
+
+// Everything a snake's step does, worked out once before it is applied
+// vacated is the end of the tail, which the snake leaves behind on a MOVE.
+typedef struct {
+    StepOutcome outcome;
+    Coords target;
+    Coords vacated;
+} StepResult;
+
+// The board the game is played on, and the limits it implies
+typedef Board<GRID_WIDTH, GRID_HEIGHT> GameBoard;
+
+static const int GRID_CELLS = GameBoard::CELLS;
+static const int MAX_SNAKE_LENGTH = GRID_CELLS - 1;
+static const int OCCUPANCY_WORDS = (GRID_CELLS + 31) / 32;
+
+static_assert(MAX_SNAKE_LENGTH <= 255, "Snake lengths are stored in a byte");
+static_assert(FOOD_COUNT >= 2, "MODE_MULTI_FOOD needs more than one food out at once");
+
+// Step length at a speed level in microseconds, clamped to the floor
+constexpr uint32_t atLeastSpeedFloor(uint32_t lengthUs) {
+    return lengthUs > SPEED_FLOOR_MS * 1000u ? lengthUs : SPEED_FLOOR_MS * 1000u;
+}
+
+constexpr uint32_t speedCurveUs(int level) {
+    return level == 0 ? atLeastSpeedFloor(SPEED_START_MS * 1000u)
+                      : atLeastSpeedFloor(speedCurveUs(level - 1) * SPEED_DECAY_PERMILLE / 1000);
+}
+
+// The whole curve, expanded into a table by the compiler
+template <class Indices> struct SpeedTable;
+
+template <int... I> struct SpeedTable<IndexList<I...>> {
+    static constexpr uint32_t lengthUs[sizeof...(I)] = {speedCurveUs(I)...};
+};
+
+template <int... I> constexpr uint32_t SpeedTable<IndexList<I...>>::lengthUs[sizeof...(I)];
+
+typedef SpeedTable<MakeIndices<SPEED_LEVELS>::type> SpeedCurve;
+
+static_assert(SpeedCurve::lengthUs[SPEED_LEVELS - 1] == SPEED_FLOOR_MS * 1000u,
+              "The speed curve must reach its floor within SPEED_LEVELS");
+
+// Snake structure
+// The tail is a ring buffer: tail[tailStart] is the end of the tail and the
+// segment next to the head sits tailLength - 1 slots after it.
+typedef struct {
+    Coords head;
+    Coords tail[MAX_SNAKE_LENGTH];
+    uint8_t tailStart;
+    uint8_t tailLength;
+    Direction direction;
+} Snake;
+
+// Game state
+// rngState drives all in-game randomness, so a game replays exactly from seed.
+// occupancy holds one bit per grid cell covered by any snake's head or tail, or by an
+// obstacle; obstacles has the bits of the obstacles alone, for drawing them.
+// extraFood holds MODE_MULTI_FOOD's other foods, off the board at (-1, -1) when there's
+// no room for them. foodCoords always holds a food while the game is on.
+// Fields run from widest to narrowest so the struct carries no padding.
+typedef struct {
+    uint32_t seed;
+    uint32_t rngState;
+    uint32_t occupancy[OCCUPANCY_WORDS];
+    uint32_t obstacles[OCCUPANCY_WORDS];
+    Snake snakes[MAX_PLAYERS];
+    uint16_t occupiedCells;
+    Coords foodCoords;
+    Coords extraFood[FOOD_COUNT - 1];
+    uint8_t playerCount;
+    uint8_t speed;
+    uint8_t score;
+    uint8_t loser;
+    GameStatus status;
+    GameMode mode;
+} Game;
+
+// What the game core needs from the platform running it
+typedef struct {
+    // The turn to apply to a player's snake on this step, TURN_NONE for none
+    Turn (*nextTurn)(int player);
+    // A cell has changed and needs redrawing
+    void (*cellChanged)(Coords coords);
+    // A snake is about to take this step
+    void (*stepped)(int player, const StepResult *step);
+} Platform;
+
+extern HOST_THREAD_LOCAL Game game;
+
+// Function declarations
+void setPlatform(const Platform *newPlatform);
+void initGame(uint32_t seed, int players = 1, GameMode mode = MODE_WRAP);
+void placeFood(void);
+bool coordsEqual(Coords a, Coords b);
+bool coordsInSnake(Coords coords);
+bool coordsIsHead(Coords coords);
+bool coordsIsFood(Coords coords);
+bool coordsIsObstacle(Coords coords);
+int tailIndex(const Snake *snake, int segment);
+void setOccupied(Coords coords, bool occupied);
+uint32_t nextRandom(void);
+Coords getRandomCoords(void);
+Coords getNextMove(int player);
+void planStep(int player, StepResult *step);
+void moveSnake(int player, const StepResult *step);
+void applyStep(int player, const StepResult *step);
+Direction applyTurn(Direction direction, Turn turn);
+Turn turnToward(Direction from, Direction to);
+void turnSnake(int player, Turn turn);
+void stepGame(void);
+uint32_t getStepLengthUs(void);
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * Persistent high-score table for the snake game
+ */
+
+#include "MicroBit.h"
+#include "FlashLog.h"
+#include "HighScores.h"
+
+// Two pages, so the last saved table survives the erase that makes room for the next
+#define HIGH_SCORE_LOG_PAGES 2
+
+FLASH_LOG_REGION(highScoreRegion, HIGH_SCORE_LOG_PAGES);
+
+static const FlashLog highScoreLog = {highScoreRegion, HIGH_SCORE_LOG_PAGES, sizeof(HighScoreTable)};
+
+// The current table, highest score first
+HighScoreTable highScores;
+
+// Set when the table has changed since it was last written
+static bool dirty = false;
+
+// Read the newest table back from the log, or start an empty one
+void highScoresLoad(void) {
+    if (!flashLogRead(&highScoreLog, &highScores)) {
+        memset(&highScores, 0, sizeof(highScores));
+    }
+    dirty = false;
+}
+
+// Insert a finished game's score, returning true if it made the table
+bool highScoresSubmit(uint8_t score) {
+    int position = HIGH_SCORE_COUNT;
+    while (position > 0 && score > highScores.scores[position - 1]) {
+        position--;
+    }
+    if (position == HIGH_SCORE_COUNT) {
+        return false;
+    }
+
+    for (int i = HIGH_SCORE_COUNT - 1; i > position; i--) {
+        highScores.scores[i] = highScores.scores[i - 1];
+    }
+    highScores.scores[position] = score;
+    dirty = true;
+    return true;
+}
+
+// Append the table to the log if it changed, returning the flash log's status
+int highScoresSave(void) {
+    if (!dirty) {
+        return MICROBIT_OK;
+    }
+    int status = flashLogAppend(&highScoreLog, &highScores);
+    if (status != MICROBIT_OK) {
+        return status;
+    }
+
+    dirty = false;
+    return MICROBIT_OK;
+}
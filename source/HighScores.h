@@ -0,0 +1,29 @@
+/**
+ * Persistent high-score table for the snake game
+ *
+ * The table is kept in RAM and written back at most once per game over, and
+ * only when a new score made it in. Each write appends the whole table to a
+ * flash log on pages of its own, and boot reads back the newest copy, so an
+ * interrupted write never loses the previous table.
+ */
+
+#ifndef SNAKE_HIGH_SCORES_H
+#define SNAKE_HIGH_SCORES_H
+
+#include <stdint.h>
+
+#define HIGH_SCORE_COUNT 5
+
+// The table as one record of the high-score log
+typedef struct {
+    uint8_t scores[HIGH_SCORE_COUNT];
+} HighScoreTable;
+
+extern HighScoreTable highScores;
+
+// Function declarations
+void highScoresLoad(void);
+bool highScoresSubmit(uint8_t score);
+int highScoresSave(void);
+
+#endif
@@ -0,0 +1,43 @@
+/**
+ * Display backend for the micro:bit's built-in 5x5 LED matrix
+ */
+
+#include "MicroBit.h"
+#include "Display.h"
+
+extern MicroBit uBit;
+
+// Frame being drawn; the matrix only sees it once present() copies it over whole
+static MicroBitImage backBuffer;
+
+// Function declarations
+static void ledMatrixInit(void);
+static void ledMatrixSetCell(Coords coords, uint8_t brightness);
+static void ledMatrixClear(void);
+static void ledMatrixPresent(void);
+
+const DisplayBackend ledMatrixDisplay = {ledMatrixInit, ledMatrixSetCell, ledMatrixClear, ledMatrixPresent};
+
+// Size the back buffer to the matrix
+static void ledMatrixInit(void) {
+    backBuffer = MicroBitImage(uBit.display.image.getWidth(), uBit.display.image.getHeight());
+}
+
+// Draw a cell; cells beyond the matrix are dropped by the image
+static void ledMatrixSetCell(Coords coords, uint8_t brightness) {
+    backBuffer.setPixelValue(coords.col, coords.row, brightness);
+}
+
+// Blank the back buffer
+static void ledMatrixClear(void) {
+    backBuffer.clear();
+}
+
+// Hand the finished back buffer to the display driver in one step
+// The row-scan interrupt is held off for the copy, so no row is ever lit from a half
+// written frame; the copy is a few microseconds, well inside one row period.
+static void ledMatrixPresent(void) {
+    target_disable_irq();
+    uBit.display.image.paste(backBuffer);
+    target_enable_irq();
+}
@@ -0,0 +1,67 @@
+/**
+ * Display backend for an external NeoPixel (WS2812B) panel on P0
+ *
+ * The panel is GRID_WIDTH x GRID_HEIGHT pixels, one per cell. Frames are
+ * streamed by neopixel_send_buffer(), which feeds the PWM peripheral from the
+ * GRB buffer by DMA, so the CPU is never bit-banging the data line.
+ */
+
+#include "MicroBit.h"
+#include "Display.h"
+#include "Game.h"
+
+extern MicroBit uBit;
+
+#define BYTES_PER_PIXEL 3
+
+// GRB bytes in wiring order, ready to be streamed out as is
+static uint8_t pixels[GRID_CELLS * BYTES_PER_PIXEL];
+
+// Set when the buffer differs from what the panel last received
+static bool changed = true;
+
+// Function declarations
+static void neoPixelInit(void);
+static void neoPixelSetCell(Coords coords, uint8_t brightness);
+static void neoPixelClear(void);
+static void neoPixelPresent(void);
+
+const DisplayBackend neoPixelDisplay = {neoPixelInit, neoPixelSetCell, neoPixelClear, neoPixelPresent};
+
+// Start with a dark panel
+static void neoPixelInit(void) {
+    neoPixelClear();
+    neoPixelPresent();
+}
+
+// Draw a cell in green, scaled down to keep a full panel within USB current
+static void neoPixelSetCell(Coords coords, uint8_t brightness) {
+    int col = coords.col;
+    if (NEOPIXEL_SERPENTINE && (coords.row & 1)) {
+        col = GameBoard::WIDTH - 1 - col;
+    }
+
+    uint8_t *pixel = &pixels[(coords.row * GameBoard::WIDTH + col) * BYTES_PER_PIXEL];
+    uint8_t level = (brightness * NEOPIXEL_MAX_LEVEL) / 255;
+    if (pixel[0] != level) {
+        pixel[0] = level;
+        changed = true;
+    }
+}
+
+// Blank the back buffer
+static void neoPixelClear(void) {
+    memset(pixels, 0, sizeof(pixels));
+    changed = true;
+}
+
+// Stream the frame to the panel, skipping it when nothing changed
+// WS2812B pixels latch when the line idles, so the panel always shows whole frames.
+static void neoPixelPresent(void) {
+    if (!changed) {
+        return;
+    }
+
+    neopixel_send_buffer(uBit.io.P0, pixels, sizeof(pixels));
+    changed = false;
+}
@@ -0,0 +1,313 @@
+/**
+ * Lockstep multiplayer over the micro:bit radio
+ *
+ * The datagram listener runs in its own fiber, but fibers are scheduled
+ * cooperatively on a single core, so it shares state with the game loop
+ * without locking.
+ */
+
+#include "MicroBit.h"
+#include "CodalDmesg.h"
+#include "Netplay.h"
+
+extern MicroBit uBit;
+
+#define PACKET_HELLO 1
+#define PACKET_TURNS 2
+
+// Lobby announcement, repeated until every board has been heard, and answered after
+typedef struct {
+    uint8_t type;
+    uint8_t reserved[3];
+    uint32_t serial;
+    uint32_t nonce;
+} HelloPacket;
+
+// The newest batch of a player's turns: tick (lastTick - count + 1 + i) sits in bits 2i
+// echoStamp/echoHold return the last stamp heard from echoPlayer, and how long it was
+// held before this packet went out, so echoPlayer can take the round trip.
+typedef struct {
+    uint8_t type;
+    uint8_t player;
+    uint8_t count;
+    uint8_t echoPlayer;
+    uint16_t seq;
+    uint16_t turns;
+    uint32_t lastTick;
+    uint32_t stampUs;
+    uint32_t echoStamp;
+    uint32_t echoHoldUs;
+} TurnsPacket;
+
+// Everything heard from one player
+typedef struct {
+    uint8_t turns[NETPLAY_WINDOW];
+    uint32_t knownTicks;
+    uint16_t lastSeq;
+    bool heard;
+    uint32_t lastStamp;
+    uint32_t lastStampRxUs;
+} PeerState;
+
+NetplayStats netplayStats;
+int netplayLocalPlayer = 0;
+
+static PeerState peers[NETPLAY_PLAYERS];
+
+// Next tick to simulate; the local player's turns are scheduled up to knownTicks
+static uint32_t simTick = 0;
+
+static uint16_t sendSeq = 0;
+static int nextEcho = 0;
+
+// Lobby: serials and nonces of the boards heard so far, ours included
+static bool inLobby = false;
+static int lobbyCount = 0;
+static uint32_t lobbySerials[NETPLAY_PLAYERS];
+static uint32_t lobbyNonces[NETPLAY_PLAYERS];
+
+// Our own announcement, kept to answer a board that is still gathering players
+static HelloPacket localHello;
+
+// Function declarations
+static void onDatagram(MicroBitEvent e);
+static void handleHello(const HelloPacket *packet);
+static void handleTurns(const TurnsPacket *packet);
+static void addLobbyMember(uint32_t serial, uint32_t nonce);
+static bool isLobbyMember(uint32_t serial);
+static void sendTurns(void);
+
+// Bring up the radio and start listening for the other boards
+void netplayInit(void) {
+    memset(&netplayStats, 0, sizeof(netplayStats));
+    netplayStats.rttMinUs = UINT32_MAX;
+
+    uBit.radio.enable();
+    uBit.radio.setGroup(NETPLAY_GROUP);
+    uBit.messageBus.listen(MICROBIT_ID_RADIO, MICROBIT_RADIO_EVT_DATAGRAM, onDatagram);
+}
+
+// Wait until NETPLAY_PLAYERS boards have announced themselves and return the shared seed
+// Players are numbered by serial number, so every board agrees without an election.
+// The bottom row of display lights one cell per board in the lobby.
+uint32_t netplayJoin(const DisplayBackend *display) {
+    memset(&localHello, 0, sizeof(localHello));
+    localHello.type = PACKET_HELLO;
+    localHello.serial = microbit_serial_number();
+    localHello.nonce = (uint32_t)system_timer_current_time_us();
+
+    memset(peers, 0, sizeof(peers));
+    lobbyCount = 0;
+    addLobbyMember(localHello.serial, localHello.nonce);
+    inLobby = true;
+
+    // Keep announcing for a while after the lobby fills so the late listeners fill too
+    uint64_t fullAt = 0;
+    while (lobbyCount < NETPLAY_PLAYERS || system_timer_current_time() - fullAt < NETPLAY_LINGER_MS) {
+        uBit.radio.datagram.send((uint8_t *)&localHello, sizeof(localHello));
+        display->clear();
+        for (int i = 0; i < lobbyCount && i < GameBoard::WIDTH; i++) {
+            Coords coords = {(int8_t)(GameBoard::HEIGHT - 1), (int8_t)i};
+            display->setCell(coords, 255);
+        }
+        display->present();
+        uBit.sleep(NETPLAY_HELLO_MS);
+        if (lobbyCount == NETPLAY_PLAYERS && fullAt == 0) {
+            fullAt = system_timer_current_time();
+        }
+    }
+    inLobby = false;
+
+    uint32_t seed = 0;
+    netplayLocalPlayer = 0;
+    for (int i = 0; i < NETPLAY_PLAYERS; i++) {
+        seed ^= lobbyNonces[i];
+        if (lobbySerials[i] < localHello.serial) {
+            netplayLocalPlayer++;
+        }
+    }
+
+    // The first ticks fall inside the input delay and are empty for everyone
+    for (int player = 0; player < NETPLAY_PLAYERS; player++) {
+        if (peers[player].knownTicks < NETPLAY_INPUT_DELAY) {
+            peers[player].knownTicks = NETPLAY_INPUT_DELAY;
+        }
+    }
+    simTick = 0;
+
+    DMESG("net joined player=%d of %d", netplayLocalPlayer, NETPLAY_PLAYERS);
+    return seed;
+}
+
+// Check whether every player's turn for the next tick has arrived
+bool netplayReady(void) {
+    for (int player = 0; player < NETPLAY_PLAYERS; player++) {
+        if (peers[player].knownTicks <= simTick) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Schedule the local turn NETPLAY_INPUT_DELAY ticks ahead and send it with the recent ones
+void netplayQueueTurn(Turn turn) {
+    PeerState *local = &peers[netplayLocalPlayer];
+    local->turns[local->knownTicks % NETPLAY_WINDOW] = turn;
+    local->knownTicks++;
+    sendTurns();
+}
+
+// A player's turn for the tick being simulated
+Turn netplayTurn(int player) {
+    return (Turn)peers[player].turns[simTick % NETPLAY_WINDOW];
+}
+
+// Move on to the next tick once the current one has been simulated
+void netplayAdvance(void) {
+    simTick++;
+}
+
+// The tick is held waiting on a peer; resend in case it lost our last batch
+void netplayStall(void) {
+    netplayStats.stalls++;
+    sendTurns();
+}
+
+// Write the link counters through DMESG
+void netplayDump(void) {
+    uint32_t rttAvgUs = netplayStats.rttSamples ? netplayStats.rttTotalUs / netplayStats.rttSamples : 0;
+    DMESG("net sent=%d recv=%d lost=%d stalls=%d rtt_min=%d rtt_avg=%d rtt_max=%d",
+          (int)netplayStats.sent, (int)netplayStats.received, (int)netplayStats.lost,
+          (int)netplayStats.stalls, netplayStats.rttSamples ? (int)netplayStats.rttMinUs : 0,
+          (int)rttAvgUs, (int)netplayStats.rttMaxUs);
+}
+
+// Drain every datagram the radio has queued
+static void onDatagram(MicroBitEvent) {
+    uint8_t buffer[32];
+    int length;
+    while ((length = uBit.radio.datagram.recv(buffer, sizeof(buffer))) > 0) {
+        if (buffer[0] == PACKET_HELLO && length == sizeof(HelloPacket)) {
+            handleHello((const HelloPacket *)buffer);
+        } else if (buffer[0] == PACKET_TURNS && length == sizeof(TurnsPacket)) {
+            handleTurns((const TurnsPacket *)buffer);
+        }
+    }
+}
+
+// Note a board announcing itself while we're still gathering players
+// Once our lobby has closed, a member still announcing missed our HELLOs, perhaps by
+// booting after we stopped lingering. Nobody can step past the input delay without its
+// turns, so answering lets it fill its lobby and join the game where it stands.
+static void handleHello(const HelloPacket *packet) {
+    if (inLobby) {
+        addLobbyMember(packet->serial, packet->nonce);
+    } else if (isLobbyMember(packet->serial)) {
+        uBit.radio.datagram.send((uint8_t *)&localHello, sizeof(localHello));
+    }
+}
+
+// Keep the lobby sorted by serial, ignoring repeats and boards beyond the player count
+static void addLobbyMember(uint32_t serial, uint32_t nonce) {
+    int position = 0;
+    while (position < lobbyCount && lobbySerials[position] < serial) {
+        position++;
+    }
+    if ((position < lobbyCount && lobbySerials[position] == serial) || lobbyCount == NETPLAY_PLAYERS) {
+        return;
+    }
+
+    for (int i = lobbyCount; i > position; i--) {
+        lobbySerials[i] = lobbySerials[i - 1];
+        lobbyNonces[i] = lobbyNonces[i - 1];
+    }
+    lobbySerials[position] = serial;
+    lobbyNonces[position] = nonce;
+    lobbyCount++;
+}
+
+// Check whether a board made it into the lobby
+static bool isLobbyMember(uint32_t serial) {
+    for (int i = 0; i < lobbyCount; i++) {
+        if (lobbySerials[i] == serial) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Take whatever new turns a batch carries, and its loss and round-trip information
+static void handleTurns(const TurnsPacket *packet) {
+    if (packet->player >= NETPLAY_PLAYERS || packet->player == netplayLocalPlayer || packet->count == 0) {
+        return;
+    }
+
+    PeerState *peer = &peers[packet->player];
+    uint32_t nowUs = (uint32_t)system_timer_current_time_us();
+    netplayStats.received++;
+
+    // Sequence numbers only tell us about loss; duplicates and reordering are harmless
+    uint16_t gap = packet->seq - peer->lastSeq;
+    if (!peer->heard) {
+        peer->heard = true;
+    } else if (gap == 0 || gap > 0x8000) {
+        return;
+    } else {
+        netplayStats.lost += gap - 1;
+    }
+    peer->lastSeq = packet->seq;
+    peer->lastStamp = packet->stampUs;
+    peer->lastStampRxUs = nowUs;
+
+    // A batch always reaches back to the oldest tick we can still be missing
+    uint32_t firstTick = packet->lastTick + 1 - packet->count;
+    if (firstTick <= peer->knownTicks && packet->lastTick >= peer->knownTicks) {
+        for (uint32_t tick = peer->knownTicks; tick <= packet->lastTick; tick++) {
+            peer->turns[tick % NETPLAY_WINDOW] = (packet->turns >> (2 * (tick - firstTick))) & 3;
+        }
+        peer->knownTicks = packet->lastTick + 1;
+    }
+
+    if (packet->echoPlayer == netplayLocalPlayer && packet->echoStamp != 0) {
+        uint32_t rttUs = nowUs - packet->echoStamp - packet->echoHoldUs;
+        netplayStats.rttSamples++;
+        netplayStats.rttTotalUs += rttUs;
+        if (rttUs < netplayStats.rttMinUs) {
+            netplayStats.rttMinUs = rttUs;
+        }
+        if (rttUs > netplayStats.rttMaxUs) {
+            netplayStats.rttMaxUs = rttUs;
+        }
+    }
+}
+
+// Broadcast the newest local turns, echoing one peer's stamp in turn
+static void sendTurns(void) {
+    const PeerState *local = &peers[netplayLocalPlayer];
+    TurnsPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.type = PACKET_TURNS;
+    packet.player = netplayLocalPlayer;
+    packet.seq = ++sendSeq;
+    packet.lastTick = local->knownTicks - 1;
+    packet.count = local->knownTicks < NETPLAY_BATCH_TICKS ? local->knownTicks : NETPLAY_BATCH_TICKS;
+
+    uint32_t firstTick = local->knownTicks - packet.count;
+    for (int i = 0; i < packet.count; i++) {
+        packet.turns |= (uint16_t)(local->turns[(firstTick + i) % NETPLAY_WINDOW] << (2 * i));
+    }
+
+    nextEcho = (nextEcho + 1) % NETPLAY_PLAYERS;
+    if (nextEcho == netplayLocalPlayer) {
+        nextEcho = (nextEcho + 1) % NETPLAY_PLAYERS;
+    }
+    uint32_t nowUs = (uint32_t)system_timer_current_time_us();
+    packet.echoPlayer = nextEcho;
+    packet.echoStamp = peers[nextEcho].lastStamp;
+    packet.echoHoldUs = nowUs - peers[nextEcho].lastStampRxUs;
+    packet.stampUs = nowUs;
+
+    if (uBit.radio.datagram.send((uint8_t *)&packet, sizeof(packet)) == MICROBIT_OK) {
+        netplayStats.sent++;
+    }
+}
@@ -0,0 +1,60 @@
+/**
+ * Lockstep multiplayer over the micro:bit radio
+ *
+ * Every board runs the same deterministic simulation, so only turns go over
+ * the air. A local turn is scheduled NETPLAY_INPUT_DELAY ticks ahead and each
+ * packet repeats the last NETPLAY_BATCH_TICKS scheduled turns, which gives a
+ * late packet a few ticks to arrive and lets the next one repair a lost one.
+ */
+
+#ifndef SNAKE_NETPLAY_H
+#define SNAKE_NETPLAY_H
+
+#include <stdint.h>
+#include "Game.h"
+#include "Display.h"
+
+// Netplay configuration
+#ifndef NETPLAY_PLAYERS
+#define NETPLAY_PLAYERS 2
+#endif
+
+#define NETPLAY_GROUP 73
+#define NETPLAY_INPUT_DELAY 3
+#define NETPLAY_BATCH_TICKS 8
+#define NETPLAY_WINDOW 32
+#define NETPLAY_HELLO_MS 100
+#define NETPLAY_LINGER_MS 1000
+#define NETPLAY_RETRY_US 20000
+
+static_assert(NETPLAY_PLAYERS >= 2 && NETPLAY_PLAYERS <= MAX_PLAYERS, "Netplay needs 2 to MAX_PLAYERS players");
+static_assert(NETPLAY_BATCH_TICKS > 2 * NETPLAY_INPUT_DELAY && NETPLAY_BATCH_TICKS <= 8,
+              "A batch must reach back past the furthest a peer can lag, in 16 bits");
+static_assert(NETPLAY_WINDOW > NETPLAY_BATCH_TICKS + 2 * NETPLAY_INPUT_DELAY, "Turn window too small");
+
+// Link counters for tuning the input delay and batch size
+typedef struct {
+    uint32_t sent;
+    uint32_t received;
+    uint32_t lost;
+    uint32_t stalls;
+    uint32_t rttSamples;
+    uint32_t rttMinUs;
+    uint32_t rttMaxUs;
+    uint64_t rttTotalUs;
+} NetplayStats;
+
+extern NetplayStats netplayStats;
+extern int netplayLocalPlayer;
+
+// Function declarations
+void netplayInit(void);
+uint32_t netplayJoin(const DisplayBackend *display);
+bool netplayReady(void);
+void netplayQueueTurn(Turn turn);
+Turn netplayTurn(int player);
+void netplayAdvance(void);
+void netplayStall(void);
+void netplayDump(void);
+
+#endif
@@ -0,0 +1,77 @@
+/**
+ * Per-phase tick profiler for the snake game
+ */
+
+#include "CodalDmesg.h"
+#include "Profiler.h"
+
+#define CYCLES_PER_US (SystemCoreClock / 1000000)
+
+static const char *const phaseNames[PHASE_COUNT] = {"input", "step", "render", "slack"};
+
+// Statistics collected since the last dump
+static PhaseProfile profiles[PHASE_COUNT];
+
+// Clear one phase ready for the next window
+static void resetProfile(PhaseProfile *profile) {
+    memset(profile, 0, sizeof(PhaseProfile));
+    profile->minCycles = 0xFFFFFFFF;
+}
+
+// Enable the DWT cycle counter and reset every phase
+void profilerInit(void) {
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        resetProfile(&profiles[phase]);
+    }
+}
+
+// Add one sample, in CPU cycles, to a phase
+void profilerRecord(ProfilePhase phase, uint32_t cycles) {
+    PhaseProfile *profile = &profiles[phase];
+    profile->samples++;
+    profile->totalCycles += cycles;
+    if (cycles < profile->minCycles) {
+        profile->minCycles = cycles;
+    }
+    if (cycles > profile->maxCycles) {
+        profile->maxCycles = cycles;
+    }
+
+    // Bucket b holds samples under 16 * 4^b microseconds
+    uint32_t us = cycles / CYCLES_PER_US;
+    int bucket = 0;
+    for (us >>= 4; us && bucket < PROFILE_BUCKETS - 1; us >>= 2) {
+        bucket++;
+    }
+    profile->histogram[bucket]++;
+}
+
+// Add one sample measured in microseconds
+// The cycle counter stops while the core sleeps, so sleep slack is timed on the system timer.
+void profilerRecordUs(ProfilePhase phase, uint32_t us) {
+    profilerRecord(phase, us * CYCLES_PER_US);
+}
+
+// Write the statistics for every phase through DMESG and start a new window
+void profilerDump(void) {
+    uint32_t cyclesPerUs = CYCLES_PER_US;
+
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        PhaseProfile *profile = &profiles[phase];
+        if (profile->samples == 0) {
+            continue;
+        }
+
+        uint32_t *h = profile->histogram;
+        DMESG("prof %s n=%d min=%d avg=%d max=%d mhz=%d hist=%d,%d,%d,%d,%d,%d,%d,%d",
+              phaseNames[phase], (int)profile->samples, (int)profile->minCycles,
+              (int)(profile->totalCycles / profile->samples), (int)profile->maxCycles,
+              (int)cyclesPerUs, (int)h[0], (int)h[1], (int)h[2], (int)h[3], (int)h[4], (int)h[5],
+              (int)h[6], (int)h[7]);
+        resetProfile(profile);
+    }
+}
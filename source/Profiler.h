@@ -0,0 +1,46 @@
+/**
+ * Per-phase tick profiler for the snake game
+ *
+ * Times each phase of the game loop with the Cortex-M4 DWT cycle counter and
+ * keeps min/avg/max plus a coarse histogram in RAM. profilerDump() writes one
+ * "prof" line per phase through DMESG for utils/debug/dmesg.js to summarise.
+ */
+
+#ifndef SNAKE_PROFILER_H
+#define SNAKE_PROFILER_H
+
+#include "MicroBit.h"
+
+// Phases of one game loop tick
+typedef enum {
+    PHASE_INPUT,
+    PHASE_STEP,
+    PHASE_RENDER,
+    PHASE_SLACK,
+    PHASE_COUNT
+} ProfilePhase;
+
+// Histogram buckets grow by 4x from under 16 us upwards
+#define PROFILE_BUCKETS 8
+
+// Cycle statistics for one phase
+typedef struct {
+    uint32_t samples;
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+    uint32_t histogram[PROFILE_BUCKETS];
+} PhaseProfile;
+
+// Function declarations
+void profilerInit(void);
+void profilerRecord(ProfilePhase phase, uint32_t cycles);
+void profilerRecordUs(ProfilePhase phase, uint32_t us);
+void profilerDump(void);
+
+// Current value of the free-running cycle counter
+inline uint32_t profilerCycles(void) {
+    return DWT->CYCCNT;
+}
+
+#endif
@@ -0,0 +1,43 @@
+/**
+ * Seeded random turns for the benchmarks and tests
+ *
+ * The host tools and the on-device self-benchmark all steer with this one
+ * xorshift32 stream, kept apart from the game's own PRNG, so a seed plays the
+ * same game on every one of them.
+ */
+
+#ifndef SNAKE_RANDOM_TURNS_H
+#define SNAKE_RANDOM_TURNS_H
+
+#include "Game.h"
+
+// Seed the benchmarks start the turn stream from
+#define RANDOM_TURN_SEED 0x9E3779B9u
+
+// Advance a xorshift32 state, which must not be zero, and return the new value
+inline uint32_t xorshift32(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// Turn left or right on roughly one step in four
+inline Turn randomTurnFrom(uint32_t *state) {
+    switch (xorshift32(state) & 7) {
+        case 0:
+            return TURN_LEFT;
+        case 1:
+            return TURN_RIGHT;
+        default:
+            return TURN_NONE;
+    }
+}
+
+// Platform hooks for runs with nothing to draw or report
+inline void ignoreCell(Coords coords) {}
+inline void ignoreStep(int player, const StepResult *step) {}
+
+#endif
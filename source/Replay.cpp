@@ -0,0 +1,51 @@
+/**
+ * Replay recording and playback for the snake game
+ */
+
+#include <string.h>
+#include "Replay.h"
+
+// The replay being recorded or played back
+Replay replay;
+
+// Start recording a new game
+void replayBegin(uint32_t seed, GameMode mode) {
+    replay.seed = seed;
+    replay.mode = mode;
+    replay.ticks = 0;
+    replay.position = 0;
+    replay.truncated = false;
+    memset(replay.data, 0, sizeof(replay.data));
+}
+
+// Append the turn applied on this tick, dropping the rest of the game once full
+void replayRecord(Turn turn) {
+    if (replay.ticks >= REPLAY_MAX_TURNS) {
+        replay.truncated = true;
+        return;
+    }
+
+    replay.data[replay.ticks >> 2] |= (uint8_t)turn << ((replay.ticks & 3) * 2);
+    replay.ticks++;
+}
+
+// Go back to the first tick for playback
+void replayRewind(void) {
+    replay.position = 0;
+}
+
+// Check if playback has used every recorded tick
+bool replayFinished(void) {
+    return replay.position >= replay.ticks;
+}
+
+// The turn recorded for the next tick, TURN_NONE past the end
+// Turns are read back in the order they were recorded, whichever player they belong to.
+Turn replayNextTurn(int player) {
+    if (replayFinished()) {
+        return TURN_NONE;
+    }
+
+    uint32_t tick = replay.position++;
+    return (Turn)((replay.data[tick >> 2] >> ((tick & 3) * 2)) & 3);
+}
@@ -0,0 +1,39 @@
+/**
+ * Replay recording and playback for the snake game
+ *
+ * A game is fully determined by its seed and the turn applied on each step,
+ * so a replay is the seed followed by one 2-bit turn code per tick, four to
+ * a byte. ReplayFlash.cpp saves the whole replay to flash in one write.
+ */
+
+#ifndef SNAKE_REPLAY_H
+#define SNAKE_REPLAY_H
+
+#include "Game.h"
+
+// Four turns pack into each byte
+#define REPLAY_DATA_BYTES 512
+#define REPLAY_MAX_TURNS (REPLAY_DATA_BYTES * 4)
+
+// A recorded game, appended to while recording and read back while playing
+typedef struct {
+    uint32_t seed;
+    uint32_t ticks;
+    uint32_t position;
+    bool truncated;
+    GameMode mode;
+    uint8_t data[REPLAY_DATA_BYTES];
+} Replay;
+
+extern Replay replay;
+
+// Function declarations
+void replayBegin(uint32_t seed, GameMode mode = MODE_WRAP);
+void replayRecord(Turn turn);
+void replayRewind(void);
+bool replayFinished(void);
+Turn replayNextTurn(int player = 0);
+int replaySave(void);
+bool replayLoad(void);
+
+#endif
@@ -0,0 +1,43 @@
+/**
+ * Flash persistence for replays, in a flash log of their own
+ *
+ * The whole replay struct is one log record, so saving a game is a single
+ * write, and a page erase only comes round once every few games. Saving is
+ * only done between games, never while ticks are running.
+ */
+
+#include "MicroBit.h"
+#include "FlashLog.h"
+#include "Replay.h"
+
+// Two pages, so the last saved replay survives the erase that makes room for the next
+#define REPLAY_LOG_PAGES 2
+
+FLASH_LOG_REGION(replayRegion, REPLAY_LOG_PAGES);
+
+static const FlashLog replayLog = {replayRegion, REPLAY_LOG_PAGES, sizeof(Replay)};
+
+static_assert(sizeof(Replay) + 8 <= FLASH_PAGE_BYTES, "A replay must fit in one flash page");
+
+// Write the recorded game to flash, returning the flash log's status
+int replaySave(void) {
+    return flashLogAppend(&replayLog, &replay);
+}
+
+// Read the last saved game back from flash, ready to play
+bool replayLoad(void) {
+    if (!flashLogRead(&replayLog, &replay)) {
+        replayBegin(0);
+        return false;
+    }
+
+    // Whatever was read has to be safe to play back
+    if (replay.ticks > REPLAY_MAX_TURNS) {
+        replay.ticks = REPLAY_MAX_TURNS;
+    }
+    if (replay.mode >= MODE_COUNT) {
+        replay.mode = MODE_WRAP;
+    }
+    replayRewind();
+    return true;
+}
@@ -0,0 +1,125 @@
+/**
+ * On-device self-benchmark for the snake game
+ *
+ * Runs in the main fiber before the game starts, without yielding, so the
+ * timings only include what interrupts take from it, the display refresh
+ * among them.
+ */
+
+#include <string.h>
+#include "MicroBit.h"
+#include "CodalDmesg.h"
+#include "Game.h"
+#include "RandomTurns.h"
+#include "SelfBench.h"
+
+extern MicroBit uBit;
+
+// State of the turn generator
+static uint32_t turnState;
+
+// Hooks of the drawn pass, which takes its cell hook from the caller
+static Platform drawnPlatform;
+
+// Function declarations
+static Turn benchTurn(int player);
+static uint64_t playSteps(const SelfBenchDisplay *draw, SelfBenchResult *result);
+
+// Hooks of the dark pass
+static const Platform darkPlatform = {benchTurn, ignoreCell, ignoreStep};
+
+// Steer from the turn stream snake_bench uses
+static Turn benchTurn(int player) {
+    return randomTurnFrom(&turnState);
+}
+
+// Play SELF_BENCH_STEPS steps from the fixed seed, starting the next game whenever one ends
+// With draw given, every step is rendered and timed both alone and as part of its tick.
+// Returns how long the whole run took, in microseconds.
+static uint64_t playSteps(const SelfBenchDisplay *draw, SelfBenchResult *result) {
+    if (draw) {
+        drawnPlatform.nextTurn = benchTurn;
+        drawnPlatform.cellChanged = draw->cellChanged;
+        drawnPlatform.stepped = ignoreStep;
+    }
+    setPlatform(draw ? &drawnPlatform : &darkPlatform);
+    turnState = RANDOM_TURN_SEED;
+    uint32_t seed = SELF_BENCH_SEED;
+    uint64_t renderTotalUs = 0;
+    result->games = 1;
+
+    initGame(seed);
+    if (draw) {
+        draw->render(true);
+    }
+
+    uint64_t startUs = system_timer_current_time_us();
+    for (uint32_t step = 0; step < SELF_BENCH_STEPS; step++) {
+        uint64_t tickUs = draw ? system_timer_current_time_us() : 0;
+        bool newGame = game.status != ONGOING;
+        if (newGame) {
+            initGame(++seed);
+            result->games++;
+        }
+        stepGame();
+
+        if (draw) {
+            uint64_t renderUs = system_timer_current_time_us();
+            draw->render(newGame);
+            uint64_t doneUs = system_timer_current_time_us();
+
+            uint32_t frameUs = (uint32_t)(doneUs - renderUs);
+            renderTotalUs += frameUs;
+            if (frameUs > result->renderMaxUs) {
+                result->renderMaxUs = frameUs;
+            }
+            if (doneUs - tickUs > result->tickMaxUs) {
+                result->tickMaxUs = (uint32_t)(doneUs - tickUs);
+            }
+        }
+    }
+    uint64_t elapsedUs = system_timer_current_time_us() - startUs;
+
+    if (draw) {
+        result->renderAvgUs = (uint32_t)(renderTotalUs / SELF_BENCH_STEPS);
+    }
+    return elapsedUs > 0 ? elapsedUs : 1;
+}
+
+// Play the benchmark game dark, then drawn, and fill in what was measured
+// Both passes play the same steps, so the difference between them is the drawing.
+void selfBenchRun(const SelfBenchDisplay *display, SelfBenchResult *result) {
+    memset(result, 0, sizeof(*result));
+    result->steps = SELF_BENCH_STEPS;
+
+    uint64_t darkUs = playSteps(NULL, result);
+    result->stepsPerSecDark = (uint32_t)((uint64_t)SELF_BENCH_STEPS * 1000000 / darkUs);
+
+    uint64_t drawnUs = playSteps(display, result);
+    result->stepsPerSecDrawn = (uint32_t)((uint64_t)SELF_BENCH_STEPS * 1000000 / drawnUs);
+}
+
+// Write the results through DMESG and scroll them across the display
+// The display shows dark and drawn steps/sec, then render and worst tick time in us. It
+// still runs before the game starts, so it can sleep between the columns of the scroll.
+void selfBenchReport(const SelfBenchResult *result, const DisplayBackend *display) {
+    DMESG("selfbench steps=%d games=%d dark_steps_per_sec=%d drawn_steps_per_sec=%d render_avg_us=%d "
+          "render_max_us=%d tick_max_us=%d",
+          (int)result->steps, (int)result->games, (int)result->stepsPerSecDark, (int)result->stepsPerSecDrawn,
+          (int)result->renderAvgUs, (int)result->renderMaxUs, (int)result->tickMaxUs);
+
+    // A letter, a space and up to ten digits for each of the four numbers
+    char text[4 * 12];
+    char *end = appendNumber(appendText(text, "D"), result->stepsPerSecDark);
+    end = appendNumber(appendText(end, " W"), result->stepsPerSecDrawn);
+    end = appendNumber(appendText(end, " R"), result->renderAvgUs);
+    appendNumber(appendText(end, " T"), result->tickMaxUs);
+
+    int columns = textColumns(text);
+    for (int column = 0; column < columns; column++) {
+        display->clear();
+        drawText(display, text, column);
+        display->present();
+        uBit.sleep(SELF_BENCH_SCROLL_MS);
+    }
+}
@@ -0,0 +1,44 @@
+/**
+ * On-device self-benchmark for the snake game
+ *
+ * Holding A and B through boot plays a fixed seeded game at full speed, once
+ * with nothing drawn and once drawing and presenting every step, then reports
+ * steps/sec, render time per frame and the worst tick through DMESG and on
+ * the display. The same seed and turns play out on every board, so the
+ * numbers compare across board revisions and firmware builds.
+ */
+
+#ifndef SNAKE_SELF_BENCH_H
+#define SNAKE_SELF_BENCH_H
+
+#include <stdint.h>
+#include "Board.h"
+#include "Display.h"
+
+#define SELF_BENCH_SEED 0x5EED
+#define SELF_BENCH_STEPS 10000
+#define SELF_BENCH_SCROLL_MS 120
+
+// How the benchmark draws: cellChanged collects the cells a step changed, and
+// render draws them, or the whole board when full is set, and presents the frame
+typedef struct {
+    void (*cellChanged)(Coords coords);
+    void (*render)(bool full);
+} SelfBenchDisplay;
+
+// What one benchmark run measured
+typedef struct {
+    uint32_t steps;
+    uint32_t games;
+    uint32_t stepsPerSecDark;
+    uint32_t stepsPerSecDrawn;
+    uint32_t renderAvgUs;
+    uint32_t renderMaxUs;
+    uint32_t tickMaxUs;
+} SelfBenchResult;
+
+// Function declarations
+void selfBenchRun(const SelfBenchDisplay *display, SelfBenchResult *result);
+void selfBenchReport(const SelfBenchResult *result, const DisplayBackend *display);
+
+#endif
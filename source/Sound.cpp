@@ -0,0 +1,59 @@
+/**
+ * Non-blocking sound effects for the snake game
+ */
+
+#include "MicroBit.h"
+#include "Sound.h"
+
+extern MicroBit uBit;
+
+// Built-in sound expressions for each effect
+static const char *const effectSounds[] = {NULL, "spring", "sad", "happy"};
+
+// Effect waiting for the audio fiber, and whether one is playing now
+// Fibers are cooperative, so these are only ever touched by one of them at a time.
+static SoundEffect pendingEffect = SOUND_NONE;
+static bool playing = false;
+
+// Notify event that wakes the audio fiber
+static uint16_t soundEvent;
+
+// Function declarations
+static void audioFiber(void);
+
+// Start the audio fiber
+void soundInit(void) {
+    soundEvent = allocateNotifyEvent();
+    create_fiber(audioFiber);
+}
+
+// Ask for an effect to be played; returns at once
+// A lower-priority effect arriving while another waits is dropped.
+void soundPlay(SoundEffect effect) {
+    if (effect <= pendingEffect) {
+        return;
+    }
+    pendingEffect = effect;
+    MicroBitEvent(DEVICE_ID_NOTIFY, soundEvent);
+}
+
+// Whether an effect is being synthesized right now
+bool soundPlaying(void) {
+    return playing;
+}
+
+// Play effects one at a time as they're asked for; only this fiber ever blocks on audio
+static void audioFiber(void) {
+    while (1) {
+        if (pendingEffect == SOUND_NONE) {
+            fiber_wait_for_event(DEVICE_ID_NOTIFY, soundEvent);
+            continue;
+        }
+
+        SoundEffect effect = pendingEffect;
+        pendingEffect = SOUND_NONE;
+        playing = true;
+        uBit.audio.soundExpressions.play(ManagedString(effectSounds[effect]));
+        playing = false;
+    }
+}
@@ -0,0 +1,27 @@
+/**
+ * Non-blocking sound effects for the snake game
+ *
+ * soundPlay() only records the effect and signals the audio fiber, which does
+ * the actual playing through the sound expression synthesizer and mixer. The
+ * game thread never waits on audio.
+ */
+
+#ifndef SNAKE_SOUND_H
+#define SNAKE_SOUND_H
+
+#include <stdint.h>
+
+// Effects, in rising priority: a pending effect is only replaced by a higher one
+typedef enum : uint8_t {
+    SOUND_NONE,
+    SOUND_EAT,
+    SOUND_COLLISION,
+    SOUND_WIN
+} SoundEffect;
+
+// Function declarations
+void soundInit(void);
+void soundPlay(SoundEffect effect);
+bool soundPlaying(void);
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ * Binary telemetry stream over USB serial
+ *
+ * The frames are sent from a timer event listener, which runs in its own
+ * fiber; fibers are cooperative on one core, so it reads what the game loop
+ * records without locking.
+ */
+
+#include "MicroBit.h"
+#include "Game.h"
+#include "Telemetry.h"
+
+extern MicroBit uBit;
+
+// Saturate a measurement into a 16-bit frame field
+#define CLAMP_U16(value) ((value) > 0xFFFF ? 0xFFFF : (uint16_t)(value))
+
+// What the game loop has recorded since the last frame
+static int telemetryPlayer = 0;
+static uint32_t periodUs = 0;
+static uint32_t ticks = 0;
+static uint64_t jitterTotalUs = 0;
+static uint32_t jitterMaxUs = 0;
+static uint32_t inputLatencyMaxUs = 0;
+
+// Frames sent, and frames dropped since the last one that went out
+static uint16_t sendSeq = 0;
+static uint32_t dropped = 0;
+
+// Notify event the system timer raises every period
+static uint16_t telemetryEvent;
+
+// Function declarations
+static void onTelemetryEvent(MicroBitEvent e);
+static uint32_t stackFreeBytes(void);
+
+// Start sending a frame every periodMs, returning false if the serial port can't buffer them
+// The default transmit buffer is smaller than one frame, which would drop every frame.
+bool telemetryInit(uint32_t periodMs) {
+    int txBytes = TELEMETRY_TX_BYTES;
+    if (uBit.serial.setTxBufferSize(txBytes) != MICROBIT_OK || uBit.serial.getTxBufferSize() < txBytes) {
+        return false;
+    }
+
+    telemetryEvent = allocateNotifyEvent();
+    uBit.messageBus.listen(DEVICE_ID_NOTIFY, telemetryEvent, onTelemetryEvent);
+    system_timer_event_every_us(periodMs * 1000ull, DEVICE_ID_NOTIFY, telemetryEvent);
+    return true;
+}
+
+// Note a tick: whose snake to report, the tick period and how late the tick fired
+void telemetryRecordTick(int player, uint32_t tickPeriodUs, uint32_t jitterUs) {
+    telemetryPlayer = player;
+    periodUs = tickPeriodUs;
+    ticks++;
+    jitterTotalUs += jitterUs;
+    if (jitterUs > jitterMaxUs) {
+        jitterMaxUs = jitterUs;
+    }
+}
+
+// Note the time from a press to the frame that showed its turn
+void telemetryRecordInput(uint32_t latencyUs) {
+    if (latencyUs > inputLatencyMaxUs) {
+        inputLatencyMaxUs = latencyUs;
+    }
+}
+
+// RAM left for the stack to grow into below the current frame
+// The game core never allocates, so the stack is what runs out first.
+static uint32_t stackFreeBytes(void) {
+    uint32_t marker;
+    uint32_t stackLimit = (uint32_t)DEVICE_STACK_BASE - DEVICE_STACK_SIZE;
+    uint32_t sp = (uint32_t)(uintptr_t)&marker;
+    return sp > stackLimit ? sp - stackLimit : 0;
+}
+
+// Build a frame from the interval just ended and queue it, or drop it if the buffer is full
+static void onTelemetryEvent(MicroBitEvent) {
+    TelemetryFrame frame;
+    frame.sync = TELEMETRY_SYNC;
+    frame.version = TELEMETRY_VERSION;
+    frame.seq = sendSeq;
+    frame.uptimeMs = (uint32_t)system_timer_current_time();
+    frame.tickPeriodUs = periodUs;
+    frame.jitterAvgUs = CLAMP_U16(ticks ? jitterTotalUs / ticks : 0);
+    frame.jitterMaxUs = CLAMP_U16(jitterMaxUs);
+    frame.inputLatencyMaxUs = CLAMP_U16(inputLatencyMaxUs);
+    frame.ticks = CLAMP_U16(ticks);
+    frame.stackFreeBytes = stackFreeBytes();
+    frame.score = game.score;
+    frame.length = game.snakes[telemetryPlayer].tailLength + 1;
+    frame.dropped = dropped > 0xFF ? 0xFF : (uint8_t)dropped;
+    frame.checksum = 0;
+    const uint8_t *bytes = (const uint8_t *)&frame;
+    for (unsigned i = 0; i < sizeof(frame) - 1; i++) {
+        frame.checksum ^= bytes[i];
+    }
+
+    // The interval starts over whether or not this frame makes it out
+    ticks = 0;
+    jitterTotalUs = 0;
+    jitterMaxUs = 0;
+    inputLatencyMaxUs = 0;
+
+    // Only ever copy into the transmit buffer: a frame that can't go whole goes not at all
+    // The ring holds one byte less than its size, so a frame needs more room than its length.
+    int room = uBit.serial.getTxBufferSize() - uBit.serial.txBufferedSize();
+    if (room <= (int)sizeof(frame) || uBit.serial.send((uint8_t *)&frame, sizeof(frame), ASYNC) != (int)sizeof(frame)) {
+        dropped++;
+        return;
+    }
+    sendSeq++;
+    dropped = 0;
+}
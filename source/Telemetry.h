@@ -0,0 +1,50 @@
+/**
+ * Binary telemetry stream over USB serial
+ *
+ * Every TELEMETRY period a small fixed-size frame goes into the serial
+ * transmit buffer, which the UART drains by itself. A frame that doesn't fit
+ * is dropped and counted rather than waited on, so a slow or absent host can
+ * never hold up a tick. utils/debug/telemetry.js decodes the stream.
+ */
+
+#ifndef SNAKE_TELEMETRY_H
+#define SNAKE_TELEMETRY_H
+
+#include <stdint.h>
+
+#define TELEMETRY_SYNC 0xA5
+#define TELEMETRY_VERSION 1
+
+// Frames the serial transmit buffer holds, so a few can queue behind a slow UART
+// CODAL's ring keeps one byte free to tell full from empty, so it gets one byte more.
+#define TELEMETRY_TX_FRAMES 4
+#define TELEMETRY_TX_BYTES (TELEMETRY_TX_FRAMES * sizeof(TelemetryFrame) + 1)
+
+// One telemetry frame, laid out little-endian with every field naturally aligned
+// Timings cover the ticks since the previous frame; checksum is the XOR of the bytes before it.
+typedef struct {
+    uint8_t sync;
+    uint8_t version;
+    uint16_t seq;
+    uint32_t uptimeMs;
+    uint32_t tickPeriodUs;
+    uint16_t jitterAvgUs;
+    uint16_t jitterMaxUs;
+    uint16_t inputLatencyMaxUs;
+    uint16_t ticks;
+    uint32_t stackFreeBytes;
+    uint8_t score;
+    uint8_t length;
+    uint8_t dropped;
+    uint8_t checksum;
+} TelemetryFrame;
+
+static_assert(sizeof(TelemetryFrame) == 28, "Telemetry frames must have no padding; telemetry.js relies on it");
+static_assert(TELEMETRY_TX_BYTES <= 255, "The serial transmit buffer is sized in 8 bits");
+
+// Function declarations
+bool telemetryInit(uint32_t periodMs);
+void telemetryRecordTick(int player, uint32_t periodUs, uint32_t jitterUs);
+void telemetryRecordInput(uint32_t latencyUs);
+
+#endif
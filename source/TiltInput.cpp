@@ -0,0 +1,139 @@
+/**
+ * Accelerometer tilt steering for the snake game
+ *
+ * The sample handler is registered as an immediate listener, so it runs in
+ * the fiber that read the sensor rather than waiting for its own fiber to be
+ * scheduled. That fiber is never an interrupt, so it can safely share the turn
+ * queue with the button handlers.
+ */
+
+#include "MicroBit.h"
+#include "CodalDmesg.h"
+#include "TiltInput.h"
+
+extern MicroBit uBit;
+
+// Filter state carries a few fraction bits so small changes aren't rounded away
+#define FRACTION_BITS 4
+
+TiltStats tiltStats;
+
+static void (*headingCallback)(Direction heading, uint32_t sensedUs);
+
+// Low-pass filtered tilt in milli-g, scaled by 2^FRACTION_BITS
+static int32_t filteredX = 0;
+static int32_t filteredY = 0;
+
+// Heading held by the hysteresis, if any
+static bool holding = false;
+static Direction heldHeading = UP;
+
+// Heading the unfiltered samples point at, and when they started to
+static bool rawTipped = false;
+static Direction rawHeading = UP;
+static uint32_t rawSinceUs = 0;
+
+// Function declarations
+static void onSample(MicroBitEvent e);
+static Direction dominantHeading(int32_t x, int32_t y, int32_t *strength);
+static int32_t strengthTowards(Direction heading, int32_t x, int32_t y);
+
+// Start sampling the accelerometer and report headings to the given callback
+void tiltInit(void (*onHeading)(Direction heading, uint32_t sensedUs)) {
+    memset(&tiltStats, 0, sizeof(tiltStats));
+    headingCallback = onHeading;
+
+    uBit.accelerometer.setPeriod(TILT_SAMPLE_MS);
+    uBit.messageBus.listen(MICROBIT_ID_ACCELEROMETER, MICROBIT_ACCELEROMETER_EVT_DATA_UPDATE, onSample,
+                           MESSAGE_BUS_LISTENER_IMMEDIATE);
+}
+
+// Write the filter latency statistics through DMESG
+void tiltDump(void) {
+    if (tiltStats.samples == 0) {
+        return;
+    }
+    DMESG("tilt n=%d avg_us=%d max_us=%d over_budget=%d", (int)tiltStats.samples,
+          (int)(tiltStats.totalUs / tiltStats.samples), (int)tiltStats.maxUs, (int)tiltStats.overBudget);
+}
+
+// Filter one sample and commit a heading if the tilt has settled on a new one
+static void onSample(MicroBitEvent e) {
+    uint32_t nowUs = (uint32_t)system_timer_current_time_us();
+    int32_t x = uBit.accelerometer.getX();
+    int32_t y = uBit.accelerometer.getY();
+
+    // Note when the raw samples first tip towards a heading, to time the filter against
+    int32_t rawStrength;
+    Direction raw = dominantHeading(x, y, &rawStrength);
+    if (rawStrength < TILT_ENTER_MG) {
+        rawTipped = false;
+    } else if (!rawTipped || raw != rawHeading) {
+        rawTipped = true;
+        rawHeading = raw;
+        rawSinceUs = nowUs;
+    }
+
+    // Single-pole IIR: moves 1 / 2^TILT_FILTER_SHIFT of the way to each new sample
+    filteredX += ((x << FRACTION_BITS) - filteredX) >> TILT_FILTER_SHIFT;
+    filteredY += ((y << FRACTION_BITS) - filteredY) >> TILT_FILTER_SHIFT;
+    int32_t fx = filteredX >> FRACTION_BITS;
+    int32_t fy = filteredY >> FRACTION_BITS;
+
+    if (holding && strengthTowards(heldHeading, fx, fy) >= TILT_EXIT_MG) {
+        return;
+    }
+
+    int32_t strength;
+    Direction heading = dominantHeading(fx, fy, &strength);
+    if (strength < TILT_ENTER_MG) {
+        holding = false;
+        return;
+    }
+    if (holding && heading == heldHeading) {
+        return;
+    }
+
+    holding = true;
+    heldHeading = heading;
+
+    uint32_t sensedUs = rawTipped && rawHeading == heading ? rawSinceUs : nowUs;
+    uint32_t latencyUs = nowUs - sensedUs;
+    tiltStats.samples++;
+    tiltStats.totalUs += latencyUs;
+    if (latencyUs > tiltStats.maxUs) {
+        tiltStats.maxUs = latencyUs;
+    }
+    if (latencyUs > TILT_LATENCY_BUDGET_US) {
+        tiltStats.overBudget++;
+    }
+
+    headingCallback(heading, sensedUs);
+}
+
+// The heading the board is tipped furthest towards; tipping right is +x and the top edge down is -y
+static Direction dominantHeading(int32_t x, int32_t y, int32_t *strength) {
+    int32_t ax = x < 0 ? -x : x;
+    int32_t ay = y < 0 ? -y : y;
+    if (ax >= ay) {
+        *strength = ax;
+        return x > 0 ? RIGHT : LEFT;
+    }
+    *strength = ay;
+    return y > 0 ? DOWN : UP;
+}
+
+// How far the board is tipped towards a heading, negative if away from it
+static int32_t strengthTowards(Direction heading, int32_t x, int32_t y) {
+    switch (heading) {
+        case UP:
+            return -y;
+        case DOWN:
+            return y;
+        case LEFT:
+            return -x;
+        case RIGHT:
+        default:
+            return x;
+    }
+}
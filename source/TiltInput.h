@@ -0,0 +1,41 @@
+/**
+ * Accelerometer tilt steering for the snake game
+ *
+ * Samples arrive on the accelerometer's data-update event at a fixed rate.
+ * Each one goes through a fixed-point low-pass filter and a pair of
+ * hysteresis thresholds, and a new heading is handed to the callback as soon
+ * as the board is tipped far enough towards it.
+ */
+
+#ifndef SNAKE_TILT_INPUT_H
+#define SNAKE_TILT_INPUT_H
+
+#include <stdint.h>
+#include "Board.h"
+
+// Tilt configuration, in milli-g
+// A heading is taken once the filtered tilt passes TILT_ENTER_MG and held until it
+// drops back under TILT_EXIT_MG, so a board resting near the threshold doesn't chatter.
+#define TILT_SAMPLE_MS 5
+#define TILT_FILTER_SHIFT 1
+#define TILT_ENTER_MG 350
+#define TILT_EXIT_MG 200
+
+// One 60 Hz display refresh: the filter must commit a heading faster than this
+#define TILT_LATENCY_BUDGET_US 16667
+
+// Time from the raw samples first passing the threshold to the heading being committed
+typedef struct {
+    uint32_t samples;
+    uint32_t maxUs;
+    uint64_t totalUs;
+    uint32_t overBudget;
+} TiltStats;
+
+extern TiltStats tiltStats;
+
+// Function declarations
+void tiltInit(void (*onHeading)(Direction heading, uint32_t sensedUs));
+void tiltDump(void);
+
+#endif
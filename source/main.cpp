@@ -7,435 +7,895 @@
 
 #include "MicroBit.h"
 #include "CodalDmesg.h"
+#include "Game.h"
+#include "Profiler.h"
+#include "AutoPlayer.h"
+#include "Replay.h"
+#include "HighScores.h"
+#include "Netplay.h"
+#include "Display.h"
+#include "TiltInput.h"
+#include "Sound.h"
+#include "Telemetry.h"
+#include "SelfBench.h"
 
 // Create a global instance of the MicroBit class
 MicroBit uBit;
 
 // Game constants
-#define MAX_SNAKE_LENGTH 24
-#define GRID_SIZE 5
 #define HEAD_BRIGHTNESS 255
 #define TAIL_BRIGHTNESS 128
 #define FOOD_BRIGHTNESS 255
-
-// Direction definitions
-typedef enum {
-    UP,
-    DOWN,
-    LEFT,
-    RIGHT
-} Direction;
-
-// Turn definitions
-typedef enum {
-    TURN_NONE,
-    TURN_LEFT,
-    TURN_RIGHT
-} Turn;
-
-// Game status
-typedef enum {
-    ONGOING,
-    WON,
-    LOST
-} GameStatus;
-
-// Step outcome
-typedef enum {
-    MOVE,
-    EAT,
-    COLLISION,
-    FULL
-} StepOutcome;
-
-// Coordinates on the grid
+#define OBSTACLE_BRIGHTNESS 40
+#define TICK_STATS_LEVELS 5
+#define TURN_QUEUE_SIZE 4
+#define APPLY_TURN_ON_PRESS 0
+#define LOW_POWER_MODE 0
+#define SCORE_IDLE_SLEEP_MS 10000
+#define SCORE_HOLD_MS 2000
+#define SHOW_HIGH_SCORES 1
+#define HIGH_SCORE_SCROLL_MS 80
+#define FLASH_COUNT 3
+#define FLASH_MS 200
+#define ACTIVE_CURRENT_UA 4000
+#define IDLE_CURRENT_UA 1500
+#define PROFILE_DUMP_TICKS 100
+#define AUTOPLAY_MODE 0
+#define REPLAY_PLAYBACK 0
+#define PLAYBACK_SPEEDUP 4
+#define NETPLAY 0
+#define TILT_STEERING 0
+#define SOUND_EFFECTS 0
+#define TELEMETRY 0
+#define TELEMETRY_PERIOD_MS 250
+
+// Set in the config block of codal.json to draw the first frame before bringing up
+// anything it doesn't need: the high scores, autoplay cycle, tilt, sound and telemetry
+#ifndef SNAKE_FAST_BOOT
+#define SNAKE_FAST_BOOT 0
+#endif
+
+// Mode played unless a button is held through boot: A to pick one, B for obstacles
+#define GAME_MODE MODE_WRAP
+#define MODE_PICK_POLL_MS 20
+
+#if NETPLAY && REPLAY_PLAYBACK
+#error "Replays only cover single-player games"
+#endif
+
+#if NETPLAY
+#define PLAYER_COUNT NETPLAY_PLAYERS
+#else
+#define PLAYER_COUNT 1
+#endif
+
+// Each snake touches at most its head, old head and old tail end in a step, plus the food
+#define MAX_DIRTY_CELLS (3 * PLAYER_COUNT + 1)
+
+// Set to drive a GRID_WIDTH x GRID_HEIGHT NeoPixel panel on P0 instead of the LED matrix
+#define NEOPIXEL_DISPLAY 0
+
+// What the game is doing between timer events
+typedef enum : uint8_t {
+    STATE_BOOT,
+    STATE_PLAYING,
+    STATE_FLASHING,
+    STATE_SCORE
+} MachineState;
+
+// Running min/avg/max of a timing measurement, in microseconds
 typedef struct {
-    int8_t row;
-    int8_t col;
-} Coords;
+    uint32_t samples;
+    uint32_t maxUs;
+    uint64_t totalUs;
+} TimingStats;
 
-// Snake structure
+// A button press or tilt waiting to be applied, stamped with when it happened
+// Tilts name an absolute heading, which becomes a turn when it's applied.
 typedef struct {
-    Coords head;
-    Coords tail[MAX_SNAKE_LENGTH];
-    int tailLength;
-    Direction direction;
-} Snake;
-
-// Game state
+    Turn turn;
+    bool absolute;
+    Direction heading;
+    uint32_t pressedUs;
+} TurnEvent;
+
+// Single-producer/single-consumer turn queue: the button handlers only write
+// head and the game loop only writes tail, so no locking is needed.
 typedef struct {
-    Snake snake;
-    Coords foodCoords;
-    uint8_t speed;
-    GameStatus status;
-    uint8_t score;
-} Game;
+    TurnEvent events[TURN_QUEUE_SIZE];
+    volatile uint8_t head;
+    volatile uint8_t tail;
+} TurnQueue;
+
+// Global variables for the device side of the game
+TurnQueue turnQueue;
+TimingStats tickStats[TICK_STATS_LEVELS];
+TimingStats inputLatencyStats;
+TimingStats activeStats;
+
+// Tick jitter measured while a sound effect was being synthesized
+TimingStats soundTickStats;
+
+// Press time of the turn applied on the last step, 0 if the step had none
+uint32_t appliedTurnPressedUs = 0;
+
+// Turn drained from the input queue for the step about to run
+Turn pendingTurn = TURN_NONE;
+
+// Set when the games are being played back from the saved replay
+bool playingReplay = false;
+
+// Mode of the games played this session, picked at boot
+GameMode gameMode = GAME_MODE;
+
+// The state machine runs from one notify event, raised by the system timer when the
+// current state's wait is over, or early by a press that ends the wait
+// Until the first game begins there is nothing to run, so events raised while boot
+// yields the fiber are dropped.
+uint16_t stateEvent;
+MachineState state = STATE_BOOT;
 
-// Global variables for game state
-Game game;
-Turn currentTurn = TURN_NONE;
+// When the pending state event is due, and when it was scheduled
+uint64_t deadlineUs = 0;
+uint64_t scheduledUs = 0;
+
+// Ticks since the game started, for the periodic profiler dump
+uint32_t profiledTicks = 0;
+
+// Screens of the game-over flash shown so far, alternating blank and board
+int flashPhase = 0;
+
+// High-score table scrolled ahead of the score: "HI", then a space and up to three
+// digits per score, and the columns scrolled of it so far
+static char highScoreText[2 + HIGH_SCORE_COUNT * 4 + 1];
+int highScoreColumn = 0;
+int highScoreColumns = 0;
+
+// Boot timing, reported once the first frame is up
+uint32_t initDoneUs = 0;
+uint32_t scoresLoadUs = 0;
+bool bootReported = false;
+
+// Cells changed since the last frame; fullRedraw forces every cell to be rewritten
+Coords dirtyCells[MAX_DIRTY_CELLS];
+int dirtyCount = 0;
+bool fullRedraw = true;
 
 // Function declarations
-void initGame(void);
+void initServices(void);
+void runSelfBench(void);
+void renderBenchFrame(bool full);
+GameMode readBootMode(void);
+GameMode pickBootMode(void);
+void drawBootMode(int mode);
+void startGame(uint32_t seed);
 void resetGame(void);
-void placeFood(void);
-bool coordsEqual(Coords a, Coords b);
-bool coordsInSnake(Coords coords);
-Coords getRandomCoords(void);
-Coords wraparound(Coords coords);
-Coords getNextMove(void);
-StepOutcome getStepOutcome(void);
-void moveSnake(Coords coords, bool extend);
-void handleStepOutcome(StepOutcome outcome);
-void turnSnake(Turn turn);
-void stepGame(void);
-uint32_t getStepLengthMs(void);
+uint32_t getTickLengthUs(void);
+Turn drainInput(void);
+bool pushEvent(TurnEvent event);
+bool pushTurn(Turn turn);
+void pushHeading(Direction heading, uint32_t sensedUs);
+bool popTurn(TurnEvent *event);
+Turn nextButtonTurn(void);
+Turn takePendingTurn(int player);
+void scheduleState(uint64_t atUs);
+bool pressEndsWait(void);
+void onStateEvent(MicroBitEvent e);
+void beginGame(void);
+void runTick(uint64_t tickUs);
+void endGame(void);
+void runFlash(void);
+void showHighScores(void);
+void scrollHighScores(void);
+void showScore(void);
+void leaveScore(uint64_t nowUs);
+void recordTiming(TimingStats *stats, uint32_t us);
+void recordTickJitter(uint64_t deadlineUs, uint64_t tickUs);
+void recordInputLatency(void);
+void reportTickStats(void);
+void reportPowerStats(void);
+void markDirty(Coords coords);
+void onStepped(int player, const StepResult *step);
+uint8_t getCellBrightness(Coords coords);
 void displayGameState(void);
 void displayScore(void);
 void handleButtonA(MicroBitEvent e);
 void handleButtonB(MicroBitEvent e);
 
+// Hooks the game core uses on the device
+static const Platform devicePlatform = {takePendingTurn, markDirty, onStepped};
+
+// Where frames are drawn
+static const DisplayBackend *display = NEOPIXEL_DISPLAY ? &neoPixelDisplay : &ledMatrixDisplay;
+
 // Main function
 int main() {
     // Initialize the micro:bit runtime
     uBit.init();
+    initDoneUs = (uint32_t)system_timer_current_time_us();
+    display->init();
 
     // Register button handlers
     uBit.messageBus.listen(MICROBIT_ID_BUTTON_A, MICROBIT_BUTTON_EVT_CLICK, handleButtonA);
     uBit.messageBus.listen(MICROBIT_ID_BUTTON_B, MICROBIT_BUTTON_EVT_CLICK, handleButtonB);
 
-    // Seed the random number generator with current time
-    srand(system_timer_current_time());
+    // Threaded rather than immediate: the timer raises the event from interrupt context
+    stateEvent = allocateNotifyEvent();
+    uBit.messageBus.listen(DEVICE_ID_NOTIFY, stateEvent, onStateEvent);
+#if !SNAKE_FAST_BOOT
+    initServices();
+#endif
+
+#if !NETPLAY
+    // Both buttons held through boot run the self-benchmark, then the game starts as usual
+    if (uBit.buttonA.isPressed() && uBit.buttonB.isPressed()) {
+        runSelfBench();
+    }
+#endif
+
+    // Initialize game state, seeded with the current time
+    gameMode = readBootMode();
+    profilerInit();
+    setPlatform(&devicePlatform);
+#if REPLAY_PLAYBACK
+    playingReplay = replayLoad();
+#endif
+#if NETPLAY
+    netplayInit();
+    startGame(netplayJoin(display));
+#else
+    startGame(playingReplay ? replay.seed : system_timer_current_time());
+#endif
+    beginGame();
+
+    // Everything from here on runs from state events, so the main fiber has nothing left
+    // to do and the scheduler is free for the radio, audio and tilt fibers between ticks
+    release_fiber();
+    return 0;
+}
 
-    // Initialize game state
-    initGame();
+// Bring up everything the game needs after its first frame
+// None of it is used before the first step, so fast boot runs it once the frame is up.
+void initServices(void) {
+#if TILT_STEERING
+    tiltInit(pushHeading);
+#endif
+#if SOUND_EFFECTS
+    soundInit();
+#endif
+#if TELEMETRY
+    if (!telemetryInit(TELEMETRY_PERIOD_MS)) {
+        DMESG("telemetry off: serial transmit buffer unavailable");
+    }
+#endif
 
-    // Main game loop
-    while (1) {
-        // Game loop
-        while (game.status == ONGOING) {
-            displayGameState();
-            uBit.sleep(getStepLengthMs());
-            stepGame();
-        }
+    // Load the high scores, timing it as reading flash is the slowest part
+    uint64_t scoresStartUs = system_timer_current_time_us();
+    highScoresLoad();
+    scoresLoadUs = (uint32_t)(system_timer_current_time_us() - scoresStartUs);
+    autoPlayerInit();
+}
 
-        // Game over - flash the final state
-        for (int i = 0; i < 3; i++) {
-            uBit.display.clear();
-            uBit.sleep(200);
-            displayGameState();
-            uBit.sleep(200);
-        }
+// Run the self-benchmark through the game's own drawing, and show what it measured
+void runSelfBench(void) {
+    static const SelfBenchDisplay benchDisplay = {markDirty, renderBenchFrame};
+    SelfBenchResult result;
+    selfBenchRun(&benchDisplay, &result);
+    selfBenchReport(&result, display);
+}
 
-        // Show the score
-        uBit.display.clear();
-        displayScore();
-        uBit.sleep(2000);
+// Draw one self-benchmark frame, the whole board when a new game has started
+void renderBenchFrame(bool full) {
+    if (full) {
+        fullRedraw = true;
+    }
+    displayGameState();
+    display->present();
+}
 
-        // Reset game for next round
-        resetGame();
+// Arrange for the next state event at the given time, or straight away if it has passed
+// The event comes from a microsecond timer, as uBit.sleep() would round the short steps
+// at the top of the speed curve to whole milliseconds and wake early.
+void scheduleState(uint64_t atUs) {
+    uint64_t now = system_timer_current_time_us();
+    deadlineUs = atUs;
+    scheduledUs = now;
+    system_timer_cancel_event(DEVICE_ID_NOTIFY, stateEvent);
+    if (atUs > now) {
+        system_timer_event_after_us(atUs - now, DEVICE_ID_NOTIFY, stateEvent);
+    } else {
+        MicroBitEvent(DEVICE_ID_NOTIFY, stateEvent);
     }
+}
 
-    // We should never reach here
-    return 0;
+// Whether a queued press should cut the current wait short
+// With APPLY_TURN_ON_PRESS it brings the next step forward; in LOW_POWER_MODE it ends
+// the score screen. A wake whose press was already taken is stale and is ignored.
+bool pressEndsWait(void) {
+    if (turnQueue.tail == turnQueue.head) {
+        return false;
+    }
+    return (APPLY_TURN_ON_PRESS && state == STATE_PLAYING) ||
+           (LOW_POWER_MODE && state == STATE_SCORE && highScoreColumn == highScoreColumns);
 }
 
-// Initialize the game state
-void initGame(void) {
-    // Initialize snake
-    game.snake.head.row = 2;
-    game.snake.head.col = 2;
-    game.snake.tail[0].row = 2;
-    game.snake.tail[0].col = 1;
-    game.snake.tailLength = 1;
-    game.snake.direction = RIGHT;
+// Run the current state once its wait is over
+void onStateEvent(MicroBitEvent e) {
+    uint64_t now = system_timer_current_time_us();
+    if (now < deadlineUs && !pressEndsWait()) {
+        // A stale wake from a press; the timer for this state is still pending
+        return;
+    }
+    system_timer_cancel_event(DEVICE_ID_NOTIFY, stateEvent);
 
-    // Initialize game state
-    game.speed = 1;
-    game.status = ONGOING;
-    game.score = 0;
+    switch (state) {
+        case STATE_BOOT:
+            break;
+        case STATE_PLAYING:
+            runTick(now);
+            break;
+        case STATE_FLASHING:
+            runFlash();
+            break;
+        case STATE_SCORE:
+            if (highScoreColumn < highScoreColumns) {
+                scrollHighScores();
+            } else {
+                leaveScore(now);
+            }
+            break;
+    }
+}
 
-    // Place initial food
-    placeFood();
+// Show the new board and schedule the first step of the game
+void beginGame(void) {
+    state = STATE_PLAYING;
+    profiledTicks = 0;
+    displayGameState();
+    display->present();
+    if (!bootReported) {
+        // The system timer starts in uBit.init(), so this is boot to first frame
+        uint64_t firstFrameUs = system_timer_current_time_us();
+#if SNAKE_FAST_BOOT
+        initServices();
+#endif
+        // All game state is static, so its size here is fixed at build time
+        DMESG("boot fast=%d init_us=%d first_frame_us=%d deferred_us=%d scores_load_us=%d game_bytes=%d "
+              "replay_bytes=%d",
+              SNAKE_FAST_BOOT, (int)initDoneUs, (int)firstFrameUs,
+              (int)(system_timer_current_time_us() - firstFrameUs), (int)scoresLoadUs, (int)sizeof(game),
+              (int)sizeof(replay));
+        bootReported = true;
+    }
+
+    // Ticks run on absolute deadlines so render and step time don't drift the period
+    scheduleState(system_timer_current_time_us() + getTickLengthUs());
 }
 
-// Reset the game state to start a new game
-void resetGame(void) {
-    initGame();
-    currentTurn = TURN_NONE;
+// Take one step of the game and schedule the next
+void runTick(uint64_t tickUs) {
+    profilerRecordUs(PHASE_SLACK, (uint32_t)(tickUs - scheduledUs));
+    if (tickUs < deadlineUs) {
+        // Woken early by a press, the next step is a full period from now
+        deadlineUs = tickUs;
+    } else {
+        recordTickJitter(deadlineUs, tickUs);
+    }
+
+#if NETPLAY
+    if (!netplayReady()) {
+        // A peer's turn for this step hasn't arrived: skip the step, leaving the last frame
+        // up as nothing has changed, and look again shortly after resending our own batch
+        netplayStall();
+        scheduleState(tickUs + NETPLAY_RETRY_US);
+        return;
+    }
+#endif
+
+    uint32_t inputStart = profilerCycles();
+    pendingTurn = drainInput();
+    uint32_t stepStart = profilerCycles();
+    stepGame();
+#if NETPLAY
+    netplayAdvance();
+#endif
+    uint32_t renderStart = profilerCycles();
+    displayGameState();
+    display->present();
+    uint32_t renderEnd = profilerCycles();
+    recordInputLatency();
+
+    profilerRecord(PHASE_INPUT, stepStart - inputStart);
+    profilerRecord(PHASE_STEP, renderStart - stepStart);
+    profilerRecord(PHASE_RENDER, renderEnd - renderStart);
+    if (++profiledTicks % PROFILE_DUMP_TICKS == 0) {
+        profilerDump();
+    }
+
+    // Time spent awake this tick; the rest is spent asleep in the scheduler's idle WFE
+    recordTiming(&activeStats, (uint32_t)(system_timer_current_time_us() - tickUs));
+
+    if (game.status != ONGOING) {
+        endGame();
+        return;
+    }
+
+    // Schedule from the previous deadline; if we fell a whole step behind, resync
+    // rather than bursting through the missed ticks
+    uint64_t nextUs = deadlineUs + getTickLengthUs();
+    if (nextUs < tickUs) {
+        nextUs = tickUs + getTickLengthUs();
+    }
+    scheduleState(nextUs);
 }
 
-// Check if two coordinates are equal
-bool coordsEqual(Coords a, Coords b) {
-    return (a.row == b.row && a.col == b.col);
+// Report and save the finished game, then start the game-over flash
+void endGame(void) {
+    profilerDump();
+    reportTickStats();
+    reportPowerStats();
+#if TILT_STEERING
+    tiltDump();
+#endif
+#if NETPLAY
+    netplayDump();
+#endif
+
+    // Flash writes stall the CPU, so all saving is batched here between games
+    if (!playingReplay) {
+        highScoresSubmit(game.score);
+        int status = highScoresSave();
+        if (status != MICROBIT_OK) {
+            DMESG("high scores not saved: error %d", status);
+        }
+#if !NETPLAY
+        status = replaySave();
+        if (status != MICROBIT_OK) {
+            DMESG("replay not saved: error %d", status);
+        }
+#endif
+    }
+
+    state = STATE_FLASHING;
+    flashPhase = 0;
+    runFlash();
 }
 
-// Check if coordinates are in the snake's body
-bool coordsInSnake(Coords coords) {
-    if (coordsEqual(coords, game.snake.head)) {
-        return true;
+// Game over - flash the final state FLASH_COUNT times, then move on to the score
+void runFlash(void) {
+    if (flashPhase == 2 * FLASH_COUNT) {
+#if SHOW_HIGH_SCORES
+        showHighScores();
+#else
+        showScore();
+#endif
+        return;
     }
 
-    for (int i = 0; i < game.snake.tailLength; i++) {
-        if (coordsEqual(coords, game.snake.tail[i])) {
-            return true;
-        }
+    if (flashPhase % 2 == 0) {
+        display->clear();
+    } else {
+        fullRedraw = true;
+        displayGameState();
     }
+    display->present();
+    flashPhase++;
+    scheduleState(system_timer_current_time_us() + FLASH_MS * 1000);
+}
 
-    return false;
+// Start the score screen by scrolling the high-score table across the display, best first
+void showHighScores(void) {
+    state = STATE_SCORE;
+    char *end = appendText(highScoreText, "HI");
+    for (int i = 0; i < HIGH_SCORE_COUNT && highScores.scores[i] > 0; i++) {
+        end = appendNumber(appendText(end, " "), highScores.scores[i]);
+    }
+    highScoreColumn = 0;
+    highScoreColumns = textColumns(highScoreText);
+    scrollHighScores();
 }
 
-// Get random coordinates not occupied by the snake
-Coords getRandomCoords(void) {
-    Coords coords;
-    do {
-        coords.row = rand() % GRID_SIZE;
-        coords.col = rand() % GRID_SIZE;
-    } while (coordsInSnake(coords));
+// Move the high scores on by one column, then show the score once they have scrolled off
+// Each column is its own timed step, so the handler never blocks while the text goes by.
+void scrollHighScores(void) {
+    if (highScoreColumn == highScoreColumns) {
+        showScore();
+        return;
+    }
+    display->clear();
+    drawText(display, highScoreText, highScoreColumn++);
+    display->present();
+    scheduleState(system_timer_current_time_us() + HIGH_SCORE_SCROLL_MS * 1000);
+}
 
-    return coords;
+// Show the score, held for SCORE_HOLD_MS or in LOW_POWER_MODE until a button is pressed
+void showScore(void) {
+    state = STATE_SCORE;
+    display->clear();
+    displayScore();
+    display->present();
+#if LOW_POWER_MODE
+    // The score is drawn at full brightness, so the cheaper black and white refresh is enough
+    uBit.display.setDisplayMode(DISPLAY_MODE_BLACK_AND_WHITE);
+    turnQueue.tail = turnQueue.head;
+    scheduleState(system_timer_current_time_us() + SCORE_IDLE_SLEEP_MS * 1000ull);
+#else
+    scheduleState(system_timer_current_time_us() + SCORE_HOLD_MS * 1000ull);
+#endif
 }
 
-// Place food at a random location on the grid
-void placeFood(void) {
-    game.foodCoords = getRandomCoords();
+// Leave the score screen and start the next round
+// In LOW_POWER_MODE, reaching the idle timeout rather than a press drops into deep sleep first.
+void leaveScore(uint64_t nowUs) {
+#if LOW_POWER_MODE
+    if (nowUs >= deadlineUs) {
+        // Wake on either button; program state survives deep sleep
+        uBit.io.buttonA.wakeOnActive(1);
+        uBit.io.buttonB.wakeOnActive(1);
+        uBit.power.deepSleep();
+    }
+    uBit.display.setDisplayMode(DISPLAY_MODE_GREYSCALE);
+#endif
+
+    // Reset game for next round
+    resetGame();
+    beginGame();
 }
 
-// Wrap around out of bounds coordinates
-Coords wraparound(Coords coords) {
-    Coords result = coords;
+// Pick the session's mode from the buttons held through boot
+// Netplay boards must all play the same board, so they keep GAME_MODE; both buttons
+// held together are left to the self-benchmark.
+GameMode readBootMode(void) {
+#if !NETPLAY
+    bool heldA = uBit.buttonA.isPressed();
+    bool heldB = uBit.buttonB.isPressed();
+    if (heldA && !heldB) {
+        return pickBootMode();
+    }
+    if (heldB && !heldA) {
+        return MODE_OBSTACLES;
+    }
+#endif
+    return GAME_MODE;
+}
 
-    if (result.row < 0) {
-        result.row = GRID_SIZE - 1;
-    } else if (result.row >= GRID_SIZE) {
-        result.row = 0;
+// Step through the modes from walls onwards, A moving to the next and B playing it
+// This runs before the state machine starts, so it can poll the buttons and sleep.
+GameMode pickBootMode(void) {
+    int mode = MODE_WALLS;
+    bool wasPressedA = true;
+    drawBootMode(mode);
+    while (!uBit.buttonB.isPressed()) {
+        bool pressedA = uBit.buttonA.isPressed();
+        if (pressedA && !wasPressedA) {
+            mode = (mode + 1) % MODE_COUNT;
+            drawBootMode(mode);
+        }
+        wasPressedA = pressedA;
+        uBit.sleep(MODE_PICK_POLL_MS);
     }
 
-    if (result.col < 0) {
-        result.col = GRID_SIZE - 1;
-    } else if (result.col >= GRID_SIZE) {
-        result.col = 0;
+    // Let go of B and drop the turns the picking presses queued
+    while (uBit.buttonB.isPressed()) {
+        uBit.sleep(MODE_PICK_POLL_MS);
     }
+    uBit.sleep(MODE_PICK_POLL_MS);
+    turnQueue.tail = turnQueue.head;
+    return (GameMode)mode;
+}
 
-    return result;
+// Show a mode being picked as one lit cell per mode up to it, from the middle row
+void drawBootMode(int mode) {
+    display->clear();
+    for (int i = 0; i <= mode; i++) {
+        display->setCell(GameBoard::coordsOf(GameBoard::HEIGHT / 2 * GameBoard::WIDTH + i), 255);
+    }
+    display->present();
 }
 
-// Check if coordinates are out of bounds
-bool isOutOfBounds(Coords coords) {
-    return (coords.row < 0 || coords.row >= GRID_SIZE ||
-            coords.col < 0 || coords.col >= GRID_SIZE);
+// Start a game from the given seed and redraw the whole board
+void startGame(uint32_t seed) {
+    // A replay is only the seed and the turns, so it has to be played in its own mode
+    initGame(seed, PLAYER_COUNT, playingReplay ? replay.mode : gameMode);
+    if (playingReplay) {
+        replayRewind();
+    } else {
+        replayBegin(seed, gameMode);
+    }
+    fullRedraw = true;
+    dirtyCount = 0;
 }
 
-// Get the next position the snake will move to
-Coords getNextMove(void) {
-    Coords nextMove = game.snake.head;
+// Reset the game state to start a new game
+void resetGame(void) {
+#if NETPLAY
+    // Every board finished on the same state, so they agree on the next seed without asking
+    startGame(game.rngState);
+#else
+    startGame(playingReplay ? replay.seed : system_timer_current_time());
+#endif
+
+    // Discard presses made during the game-over and score screens
+    turnQueue.tail = turnQueue.head;
+}
 
-    switch (game.snake.direction) {
-        case UP:
-            nextMove.row--;
-            break;
-        case DOWN:
-            nextMove.row++;
-            break;
-        case LEFT:
-            nextMove.col--;
-            break;
-        case RIGHT:
-            nextMove.col++;
-            break;
+// Queue an input event, dropping it if the queue is full
+// Buttons and tilt both produce from fiber context, which is never preempted by the other.
+bool pushEvent(TurnEvent event) {
+    uint8_t head = turnQueue.head;
+    uint8_t next = (head + 1) % TURN_QUEUE_SIZE;
+    if (next == turnQueue.tail) {
+        return false;
     }
 
-    if (isOutOfBounds(nextMove)) {
-        return wraparound(nextMove);
+    turnQueue.events[head] = event;
+    turnQueue.head = next;
+    if (pressEndsWait()) {
+        MicroBitEvent(DEVICE_ID_NOTIFY, stateEvent);
     }
+    return true;
+}
 
-    return nextMove;
+// Queue a relative turn from a button handler
+bool pushTurn(Turn turn) {
+    TurnEvent event;
+    event.turn = turn;
+    event.absolute = false;
+    event.heading = UP;
+    event.pressedUs = (uint32_t)system_timer_current_time_us();
+    return pushEvent(event);
 }
 
-// Determine the outcome of the snake's next move
-StepOutcome getStepOutcome(void) {
-    Coords nextMove = getNextMove();
+// Queue a heading from tilt steering, stamped with when the tilt was first sensed
+void pushHeading(Direction heading, uint32_t sensedUs) {
+    TurnEvent event;
+    event.turn = TURN_NONE;
+    event.absolute = true;
+    event.heading = heading;
+    event.pressedUs = sensedUs;
+    pushEvent(event);
+}
 
-    // Check if next move collides with snake body (but not if it's the end of the tail)
-    bool isCollision = false;
-    if (coordsInSnake(nextMove)) {
-        // If it's not the end of the tail, it's a collision
-        if (!coordsEqual(nextMove, game.snake.tail[0])) {
-            return COLLISION;
-        }
+// Take the oldest queued turn, if any
+bool popTurn(TurnEvent *event) {
+    uint8_t tail = turnQueue.tail;
+    if (tail == turnQueue.head) {
+        return false;
     }
 
-    // Check if next move is food
-    if (coordsEqual(nextMove, game.foodCoords)) {
-        // Check if the grid is full
-        if (game.snake.tailLength >= MAX_SNAKE_LENGTH - 1) {
-            return FULL;
-        }
-        return EAT;
+    *event = turnQueue.events[tail];
+    turnQueue.tail = (tail + 1) % TURN_QUEUE_SIZE;
+    return true;
+}
+
+// Apply at most one queued press per step so quick presses land on successive steps
+Turn nextButtonTurn(void) {
+    TurnEvent event;
+    appliedTurnPressedUs = 0;
+    if (!popTurn(&event)) {
+        return TURN_NONE;
     }
 
-    // Otherwise, it's just a regular move
-    return MOVE;
+    appliedTurnPressedUs = event.pressedUs;
+    if (event.absolute) {
+        return turnToward(game.snakes[netplayLocalPlayer].direction, event.heading);
+    }
+    return event.turn;
 }
 
-// Move the snake to new coordinates
-void moveSnake(Coords coords, bool extend) {
-    // Shift tail
-    if (!extend) {
-        // Remove end of tail if not extending
-        for (int i = 0; i < game.snake.tailLength - 1; i++) {
-            game.snake.tail[i] = game.snake.tail[i + 1];
-        }
-        // Move previous head to tail
-        game.snake.tail[game.snake.tailLength - 1] = game.snake.head;
-    } else {
-        // Add new tail segment and shift
-        for (int i = game.snake.tailLength; i > 0; i--) {
-            game.snake.tail[i] = game.snake.tail[i - 1];
-        }
-        // Move previous head to front of tail
-        game.snake.tail[0] = game.snake.head;
-        // Increase tail length
-        game.snake.tailLength++;
+// Length of a tick, shortened when playing a replay back faster than real time
+uint32_t getTickLengthUs(void) {
+    uint32_t lengthUs = getStepLengthUs();
+    return playingReplay ? lengthUs / PLAYBACK_SPEEDUP : lengthUs;
+}
+
+// Take the turn for the coming step from the active input source, recording it for replay
+// In netplay the turn is sent off for a later step instead, and not recorded.
+Turn drainInput(void) {
+    if (playingReplay) {
+        return replayNextTurn();
     }
 
-    // Move head to new coords
-    game.snake.head = coords;
+#if AUTOPLAY_MODE
+    Turn turn = autoPlayerTurn(netplayLocalPlayer);
+#else
+    Turn turn = nextButtonTurn();
+#endif
+#if NETPLAY
+    netplayQueueTurn(turn);
+    return TURN_NONE;
+#else
+    replayRecord(turn);
+    return turn;
+#endif
 }
 
-// Handle the outcome of a step
-void handleStepOutcome(StepOutcome outcome) {
-    Coords nextMove = getNextMove();
-
-    switch (outcome) {
-        case COLLISION:
-            game.status = LOST;
-            break;
+// Hand the drained turn, or a player's lockstep turn in netplay, to the game core
+Turn takePendingTurn(int player) {
+#if NETPLAY
+    return netplayTurn(player);
+#else
+    Turn turn = pendingTurn;
+    pendingTurn = TURN_NONE;
+    return turn;
+#endif
+}
 
-        case FULL:
-            moveSnake(nextMove, true);
-            game.status = WON;
-            break;
+// Add one sample to a set of timing statistics
+void recordTiming(TimingStats *stats, uint32_t us) {
+    stats->samples++;
+    stats->totalUs += us;
+    if (us > stats->maxUs) {
+        stats->maxUs = us;
+    }
+}
 
-        case EAT:
-            moveSnake(nextMove, true);
-            placeFood();
-            game.score++;
-            if (game.score % 5 == 0) {
-                game.speed++;
-            }
-            break;
+// Record how late a tick fired, grouping the speed levels into TICK_STATS_LEVELS bands
+void recordTickJitter(uint64_t deadlineUs, uint64_t tickUs) {
+    int level = (game.speed - 1) * TICK_STATS_LEVELS / SPEED_LEVELS;
+
+    uint32_t jitterUs = tickUs > deadlineUs ? (uint32_t)(tickUs - deadlineUs) : 0;
+    recordTiming(&tickStats[level], jitterUs);
+#if TELEMETRY
+    telemetryRecordTick(netplayLocalPlayer, getTickLengthUs(), jitterUs);
+#endif
+#if SOUND_EFFECTS
+    if (soundPlaying()) {
+        recordTiming(&soundTickStats, jitterUs);
+    }
+#endif
+}
 
-        case MOVE:
-            moveSnake(nextMove, false);
-            break;
+// Record the time from a press to the frame that shows its turn
+void recordInputLatency(void) {
+    if (appliedTurnPressedUs != 0) {
+        uint32_t latencyUs = (uint32_t)system_timer_current_time_us() - appliedTurnPressedUs;
+        recordTiming(&inputLatencyStats, latencyUs);
+#if TELEMETRY
+        telemetryRecordInput(latencyUs);
+#endif
     }
 }
 
-// Turn the snake in a new direction
-void turnSnake(Turn turn) {
-    switch (turn) {
-        case TURN_LEFT:
-            switch (game.snake.direction) {
-                case UP:
-                    game.snake.direction = LEFT;
-                    break;
-                case DOWN:
-                    game.snake.direction = RIGHT;
-                    break;
-                case LEFT:
-                    game.snake.direction = DOWN;
-                    break;
-                case RIGHT:
-                    game.snake.direction = UP;
-                    break;
-            }
-            break;
+// Dump the tick jitter and input latency statistics seen so far
+void reportTickStats(void) {
+    for (int level = 0; level < TICK_STATS_LEVELS; level++) {
+        TimingStats *stats = &tickStats[level];
+        if (stats->samples == 0) {
+            continue;
+        }
+        int firstSpeed = level * SPEED_LEVELS / TICK_STATS_LEVELS + 1;
+        DMESG("tick speed=%d period_us=%d n=%d avg_us=%d max_us=%d", firstSpeed,
+              (int)SpeedCurve::lengthUs[firstSpeed - 1], (int)stats->samples,
+              (int)(stats->totalUs / stats->samples), (int)stats->maxUs);
+    }
 
-        case TURN_RIGHT:
-            switch (game.snake.direction) {
-                case UP:
-                    game.snake.direction = RIGHT;
-                    break;
-                case DOWN:
-                    game.snake.direction = LEFT;
-                    break;
-                case LEFT:
-                    game.snake.direction = UP;
-                    break;
-                case RIGHT:
-                    game.snake.direction = DOWN;
-                    break;
-            }
-            break;
+    if (soundTickStats.samples != 0) {
+        DMESG("tick sound n=%d avg_us=%d max_us=%d", (int)soundTickStats.samples,
+              (int)(soundTickStats.totalUs / soundTickStats.samples), (int)soundTickStats.maxUs);
+    }
 
-        case TURN_NONE:
-            // No change
-            break;
+    if (inputLatencyStats.samples != 0) {
+        DMESG("input n=%d avg_us=%d max_us=%d", (int)inputLatencyStats.samples,
+              (int)(inputLatencyStats.totalUs / inputLatencyStats.samples),
+              (int)inputLatencyStats.maxUs);
     }
 }
 
-// Perform a single game step
-void stepGame(void) {
-    // Process any pending turns
-    turnSnake(currentTurn);
-    currentTurn = TURN_NONE;
+// Estimate the average current drawn per tick from the measured awake time
+// ACTIVE_CURRENT_UA and IDLE_CURRENT_UA are board figures to calibrate against a meter.
+void reportPowerStats(void) {
+    if (activeStats.samples == 0) {
+        return;
+    }
+
+    uint32_t activeUs = activeStats.totalUs / activeStats.samples;
+    uint32_t periodUs = getTickLengthUs();
+    if (activeUs > periodUs) {
+        activeUs = periodUs;
+    }
+    uint32_t currentUa = (uint32_t)(((uint64_t)ACTIVE_CURRENT_UA * activeUs +
+                                     (uint64_t)IDLE_CURRENT_UA * (periodUs - activeUs)) / periodUs);
 
-    // Get and handle the outcome of the step
-    StepOutcome outcome = getStepOutcome();
-    handleStepOutcome(outcome);
+    DMESG("power active_us=%d max_active_us=%d period_us=%d est_ua=%d", (int)activeUs,
+          (int)activeStats.maxUs, (int)periodUs, (int)currentUa);
 }
 
-// Calculate step length based on game speed
-uint32_t getStepLengthMs(void) {
-    int32_t stepLength = 1000 - (200 * ((int32_t)game.speed - 1));
-    if (stepLength < 200) {
-        stepLength = 200;
+// Queue a cell to be redrawn on the next frame
+void markDirty(Coords coords) {
+    if (dirtyCount < MAX_DIRTY_CELLS) {
+        dirtyCells[dirtyCount++] = coords;
+    } else {
+        fullRedraw = true;
     }
-    return (uint32_t)stepLength;
 }
 
-// Display the current game state on the LED matrix
-void displayGameState(void) {
-    // Clear the display
-    uBit.display.clear();
+// Queue the sound for a step's outcome; playing it never holds up the step
+void onStepped(int player, const StepResult *step) {
+#if SOUND_EFFECTS
+    switch (step->outcome) {
+        case EAT:
+            soundPlay(SOUND_EAT);
+            break;
+        case COLLISION:
+            soundPlay(SOUND_COLLISION);
+            break;
+        case FULL:
+            soundPlay(SOUND_WIN);
+            break;
+        case MOVE:
+            break;
+    }
+#endif
+}
 
-    // Draw the snake's head
-    uBit.display.image.setPixelValue(game.snake.head.col, game.snake.head.row, HEAD_BRIGHTNESS);
+// Work out what a cell should show: food first, then obstacle, then head, then body
+// Obstacles are in the occupancy bitboard, so they're told apart from the body first.
+uint8_t getCellBrightness(Coords coords) {
+    if (coordsIsFood(coords)) {
+        return FOOD_BRIGHTNESS;
+    }
+    if (coordsIsObstacle(coords)) {
+        return OBSTACLE_BRIGHTNESS;
+    }
+    if (coordsIsHead(coords)) {
+        return HEAD_BRIGHTNESS;
+    }
+    if (coordsInSnake(coords)) {
+        return TAIL_BRIGHTNESS;
+    }
+    return 0;
+}
 
-    // Draw the snake's tail
-    for (int i = 0; i < game.snake.tailLength; i++) {
-        uBit.display.image.setPixelValue(game.snake.tail[i].col, game.snake.tail[i].row, TAIL_BRIGHTNESS);
+// Draw the current game state into the back buffer
+// Only cells touched since the last frame are written; the back buffer always holds
+// the last frame drawn, so nothing needs clearing first.
+void displayGameState(void) {
+    if (fullRedraw) {
+        Coords coords;
+        for (coords.row = 0; coords.row < GameBoard::HEIGHT; coords.row++) {
+            for (coords.col = 0; coords.col < GameBoard::WIDTH; coords.col++) {
+                display->setCell(coords, getCellBrightness(coords));
+            }
+        }
+        fullRedraw = false;
+    } else {
+        for (int i = 0; i < dirtyCount; i++) {
+            Coords coords = dirtyCells[i];
+            display->setCell(coords, getCellBrightness(coords));
+        }
     }
 
-    // Draw the food
-    uBit.display.image.setPixelValue(game.foodCoords.col, game.foodCoords.row, FOOD_BRIGHTNESS);
+    dirtyCount = 0;
 }
 
-// Display the score on the LED matrix
+// Display the score as that many lit cells, filling the board a row at a time
 void displayScore(void) {
-    int fullRows = game.score / 5;
-    int remainingCols = game.score % 5;
+    int lit = game.score < GRID_CELLS ? game.score : GRID_CELLS;
+    int fullRows = lit / GameBoard::WIDTH;
+    int remainingCols = lit % GameBoard::WIDTH;
+    Coords coords;
 
     // Light up full rows
-    for (int row = 0; row < fullRows; row++) {
-        for (int col = 0; col < 5; col++) {
-            uBit.display.image.setPixelValue(col, row, 255);
+    for (coords.row = 0; coords.row < fullRows; coords.row++) {
+        for (coords.col = 0; coords.col < GameBoard::WIDTH; coords.col++) {
+            display->setCell(coords, 255);
         }
     }
 
     // Light up remaining columns in the next row
-    for (int col = 0; col < remainingCols; col++) {
-        uBit.display.image.setPixelValue(col, fullRows, 255);
+    coords.row = fullRows;
+    for (coords.col = 0; coords.col < remainingCols; coords.col++) {
+        display->setCell(coords, 255);
     }
 }
 
 // Button A handler - turn left
 void handleButtonA(MicroBitEvent e) {
-    currentTurn = TURN_LEFT;
+    pushTurn(TURN_LEFT);
 }
 
 // Button B handler - turn right
 void handleButtonB(MicroBitEvent e) {
-    currentTurn = TURN_RIGHT;
+    pushTurn(TURN_RIGHT);
 }
@@ -9,10 +9,47 @@ function fatal(msg) {
     process.exit(1)
 }
 
+// Aggregate the "prof" lines written by the snake tick profiler
+function summarizeProfile(logs) {
+    let phases = {}
+    for (let ln of logs.split(/\r?\n/)) {
+        let m = /prof (\S+) n=(\d+) min=(\d+) avg=(\d+) max=(\d+) mhz=(\d+) hist=([\d,]+)/.exec(ln)
+        if (!m) continue
+        let n = parseInt(m[2])
+        let p = phases[m[1]]
+        if (!p) {
+            p = phases[m[1]] = { n: 0, min: Infinity, total: 0, max: 0, mhz: 1, hist: [] }
+        }
+        p.n += n
+        p.min = Math.min(p.min, parseInt(m[3]))
+        p.total += parseInt(m[4]) * n
+        p.max = Math.max(p.max, parseInt(m[5]))
+        p.mhz = parseInt(m[6]) || 1
+        m[7].split(",").forEach((v, i) => p.hist[i] = (p.hist[i] || 0) + parseInt(v))
+    }
+
+    let names = Object.keys(phases)
+    if (!names.length) return
+
+    console.log("*\n* Tick profile (us)\n*\n")
+    console.log("phase         n        min        avg        max  histogram <16us x4...")
+    for (let name of names) {
+        let p = phases[name]
+        let us = c => ("          " + (c / p.mhz).toFixed(1)).slice(-10)
+        console.log((name + "        ").slice(0, 8) + ("        " + p.n).slice(-8) + " " +
+            us(p.min) + " " + us(p.total / p.n) + " " + us(p.max) + "  " + p.hist.join(","))
+    }
+}
+
 function main() {
     let mapFileName = process.argv[2]
     if (!mapFileName) {
         console.log("usage: node " + process.argv[1] + " build/mytarget/source/myprog.map")
+        console.log("       node " + process.argv[1] + " --log captured-serial.txt")
+        return
+    }
+    if (mapFileName == "--log") {
+        summarizeProfile(fs.readFileSync(process.argv[3], "utf8"))
         return
     }
     console.log("Map file: " + mapFileName)
@@ -77,8 +114,10 @@ function main() {
                 console.log(stderr)
                 console.log("No logs.")
             } else {
+                let logs = buf.slice(4, 4 + len).toString("binary")
                 console.log("*\n* Logs\n*\n")
-                console.log(buf.slice(4, 4 + len).toString("binary"))
+                console.log(logs)
+                summarizeProfile(logs)
             }
         })
 }
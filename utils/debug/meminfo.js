@@ -1,18 +1,32 @@
 #!/usr/bin/env node
 "use strict";
 
+// Allocator entry points: malloc and friends, and operator new/delete, mangled or not
+const heapSymbol = /^(malloc|calloc|realloc|free)(@.*)?$|^(_Zn[wa][jm]|_Zd[la]Pv|operator new|operator delete)/
+
 function main() {
     let fs = require("fs");
-    let mfn = process.argv[2]
+    let args = parseArgs(process.argv.slice(2))
+    let mfn = args.map
     if (!mfn) {
         console.log("usage: node " + process.argv[1] + " build/mytarget/source/myprog.map")
+        console.log("       [--module a.cpp,b.cpp] [--ram-limit bytes] [--rom-limit bytes] [--no-heap]")
+        console.log("       [--by-name NameA,NameB] [--json]")
         return
     }
+    // --json prints one summary object instead of the tables, for build.py's profile report
+    let print = console.log
+    if (args.json) console.log = () => {}
     console.log("Map file: " + mfn)
     let map = fs.readFileSync(mfn, "utf8")
     let inSect = 0
     let byFileRAM = {}
     let byFileROM = {}
+    let heapUsers = {}
+    let byNameROM = {}
+    let names = args.byName ? args.byName.split(",") : []
+    let symbol = null
+    let section = null
     for (let ln of map.split(/\r?\n/)) {
         if (ln == "Linker script and memory map") {
             inSect = 1
@@ -20,8 +34,19 @@ function main() {
         if (/^OUTPUT\(/.test(ln)) {
             inSect = 2
         }
+        if (ln == "Cross Reference Table") {
+            inSect = 3
+        }
         if (inSect == 1) {
+            // A section name too long for its column sits alone, its address on the next line
+            let long = /^ (\.\S+)$/.exec(ln)
+            if (long) {
+                section = long[1]
+                continue
+            }
             let m = /^\s*(\S*)\s+0x00000([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S+)/.exec(ln)
+            let name = m && m[1] ? m[1] : section
+            section = null
             if (m) {
                 let mark = m[1]
                 if (mark == "*fill*" || mark == ".bss" || mark == ".relocate")
@@ -34,15 +59,108 @@ function main() {
                 if (sz) {
                     let mm = addr < 0x10000000 ? byFileROM : byFileRAM
                     mm[fn] = (mm[fn] || 0) + sz
+                    for (let n of names) {
+                        if (mm == byFileROM && name && name.indexOf(n) >= 0)
+                            byNameROM[n] = (byNameROM[n] || 0) + sz
+                    }
                 }
             }
         }
+        if (inSect == 3) {
+            // Each symbol starts with its defining file; the indented lines after it reference it
+            let m = /^(\S.*?)\s+(\S+)$/.exec(ln)
+            if (m) {
+                symbol = m[1]
+            } else if ((m = /^\s+(\S+)$/.exec(ln)) && symbol && heapSymbol.test(symbol)) {
+                heapUsers[m[1]] = (heapUsers[m[1]] || []).concat(symbol)
+            }
+        }
+    }
+
+    // Flash taken by sections whose (mangled) names contain each name, like one
+    // instantiation of a template; needs -ffunction-sections to split them out
+    if (names.length) {
+        console.log("*\n* ROM by name\n*")
+        for (let n of names) printEnt(byNameROM[n] || 0, n)
+    }
+
+    let summary = { rom: total(byFileROM), ram: total(byFileRAM), byName: byNameROM }
+    if (!args.module) {
+        console.log("*\n* ROM\n*")
+        dumpMap(byFileROM)
+        console.log("*\n* RAM\n*")
+        dumpMap(byFileRAM)
+        if (args.json) print(JSON.stringify(summary))
+        return
+    }
+
+    // Budget report for just the named source files
+    let files = args.module.split(",")
+    let inModule = fn => files.some(f => fn.endsWith("/" + f + ".o"))
+    let failed = false
+    console.log("*\n* ROM (" + args.module + ")\n*")
+    summary.moduleRom = dumpMap(filterMap(byFileROM, inModule))
+    failed = checkBudget(summary.moduleRom, args.romLimit, "ROM") || failed
+    console.log("*\n* RAM (" + args.module + ")\n*")
+    summary.moduleRam = dumpMap(filterMap(byFileRAM, inModule))
+    failed = checkBudget(summary.moduleRam, args.ramLimit, "RAM") || failed
+
+    if (args.noHeap) {
+        if (inSect < 3) {
+            console.log("error: no cross reference table in the map, link with -Wl,--cref")
+            failed = true
+        }
+        for (let fn of Object.keys(heapUsers).filter(inModule)) {
+            console.log("error: " + fn + " uses the heap (" + heapUsers[fn].join(", ") + ")")
+            failed = true
+        }
+    }
+
+    if (args.json) {
+        summary.failed = failed
+        print(JSON.stringify(summary))
+    }
+    if (failed) {
+        process.exit(1)
     }
+}
+
+function parseArgs(argv) {
+    let args = {}
+    for (let i = 0; i < argv.length; i++) {
+        if (argv[i] == "--module") args.module = argv[++i]
+        else if (argv[i] == "--ram-limit") args.ramLimit = parseInt(argv[++i])
+        else if (argv[i] == "--rom-limit") args.romLimit = parseInt(argv[++i])
+        else if (argv[i] == "--no-heap") args.noHeap = true
+        else if (argv[i] == "--by-name") args.byName = argv[++i]
+        else if (argv[i] == "--json") args.json = true
+        else args.map = argv[i]
+    }
+    return args
+}
 
-    console.log("*\n* ROM\n*")
-    dumpMap(byFileROM)
-    console.log("*\n* RAM\n*")
-    dumpMap(byFileRAM)
+function filterMap(m, keep) {
+    let r = {}
+    for (let s of Object.keys(m)) {
+        if (keep(s)) r[s] = m[s]
+    }
+    return r
+}
+
+function total(m) {
+    let sum = 0
+    for (let s of Object.keys(m)) sum += m[s]
+    return sum
+}
+
+function checkBudget(sum, limit, what) {
+    if (!limit) return false
+    printEnt(limit, "LIMIT")
+    if (sum > limit) {
+        console.log("error: " + what + " use of " + sum + " bytes is over the " + limit + " byte budget")
+        return true
+    }
+    return false
 }
 
 function printEnt(sz, s) {
@@ -59,7 +177,8 @@ function dumpMap(m) {
         sum += m[s]
     }
     printEnt(sum, "TOTAL")
+    return sum
 }
 
 
-main()
\ No newline at end of file
+main()
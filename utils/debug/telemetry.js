@@ -0,0 +1,109 @@
+#!/usr/bin/env node
+"use strict";
+
+let fs = require("fs")
+let child_process = require("child_process")
+
+// Frame layout from source/Telemetry.h
+const SYNC = 0xA5
+const VERSION = 1
+const FRAME_SIZE = 28
+
+function main() {
+    let args = parseArgs(process.argv.slice(2))
+    if (!args.input) {
+        console.log("usage: node " + process.argv[1] + " /dev/ttyACM0 [--baud 115200] [--json]")
+        console.log("       node " + process.argv[1] + " captured-serial.bin [--json]")
+        return
+    }
+
+    // A serial port has to be put in raw mode first, or the tty layer mangles the bytes
+    if (/^\/dev\//.test(args.input)) {
+        let flag = process.platform == "darwin" ? "-f" : "-F"
+        child_process.execFileSync("stty", [flag, args.input, "" + args.baud, "raw", "-echo"])
+    }
+
+    let stats = { frames: 0, dropped: 0, bad: 0, lastSeq: -1 }
+    let pending = Buffer.alloc(0)
+    let stream = fs.createReadStream(args.input)
+    stream.on("data", chunk => {
+        pending = decode(Buffer.concat([pending, chunk]), frame => {
+            report(frame, stats, args.json)
+        }, stats)
+    })
+    stream.on("end", () => summarize(stats))
+    process.on("SIGINT", () => {
+        summarize(stats)
+        process.exit(0)
+    })
+}
+
+function parseArgs(argv) {
+    let args = { baud: 115200 }
+    for (let i = 0; i < argv.length; i++) {
+        if (argv[i] == "--json") args.json = true
+        else if (argv[i] == "--baud") args.baud = parseInt(argv[++i])
+        else args.input = argv[i]
+    }
+    return args
+}
+
+// Pull every whole frame out of buf, resyncing a byte at a time on garbage; returns the leftover
+function decode(buf, onFrame, stats) {
+    let pos = 0
+    while (buf.length - pos >= FRAME_SIZE) {
+        if (buf[pos] != SYNC || buf[pos + 1] != VERSION) {
+            pos++
+            continue
+        }
+        let check = 0
+        for (let i = 0; i < FRAME_SIZE - 1; i++) check ^= buf[pos + i]
+        if (check != buf[pos + FRAME_SIZE - 1]) {
+            stats.bad++
+            pos++
+            continue
+        }
+        onFrame(parseFrame(buf, pos))
+        pos += FRAME_SIZE
+    }
+    return buf.slice(pos)
+}
+
+function parseFrame(buf, pos) {
+    return {
+        seq: buf.readUInt16LE(pos + 2),
+        uptimeMs: buf.readUInt32LE(pos + 4),
+        tickPeriodUs: buf.readUInt32LE(pos + 8),
+        jitterAvgUs: buf.readUInt16LE(pos + 12),
+        jitterMaxUs: buf.readUInt16LE(pos + 14),
+        inputLatencyMaxUs: buf.readUInt16LE(pos + 16),
+        ticks: buf.readUInt16LE(pos + 18),
+        stackFreeBytes: buf.readUInt32LE(pos + 20),
+        score: buf[pos + 24],
+        length: buf[pos + 25],
+        dropped: buf[pos + 26],
+    }
+}
+
+function report(frame, stats, json) {
+    stats.frames++
+    stats.dropped += frame.dropped
+    stats.lastSeq = frame.seq
+    if (json) {
+        console.log(JSON.stringify(frame))
+        return
+    }
+    console.log("seq=" + frame.seq + " up_ms=" + frame.uptimeMs + " score=" + frame.score +
+        " len=" + frame.length + " period_us=" + frame.tickPeriodUs + " ticks=" + frame.ticks +
+        " jitter_avg_us=" + frame.jitterAvgUs + " jitter_max_us=" + frame.jitterMaxUs +
+        " input_max_us=" + frame.inputLatencyMaxUs + " stack_free=" + frame.stackFreeBytes +
+        " dropped=" + frame.dropped)
+}
+
+function summarize(stats) {
+    // The device counts the frames it couldn't queue; corrupt ones are only seen here
+    console.error("frames=" + stats.frames + " dropped_on_device=" + stats.dropped + " corrupt=" + stats.bad)
+}
+
+
+main()